@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+
+#ifdef BENCH_HOST
+#include <chrono>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+int openCounter(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Not available in most containers and VMs, the report then shows null
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+uint64_t readCounter(int fd) {
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
+
+void restartCounter(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+#endif
+
+Benchmark::Benchmark(Print& output, const char* target)
+    : _output(output), _target(target), _startNanos(0), _startCycles(0), _cyclesFd(-1), _instructionsFd(-1) {
+#ifdef BENCH_HOST
+    _cyclesFd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+    _instructionsFd = openCounter(PERF_COUNT_HW_INSTRUCTIONS);
+#endif
+}
+
+Benchmark::~Benchmark() {
+#ifdef BENCH_HOST
+    if (_cyclesFd >= 0) close(_cyclesFd);
+    if (_instructionsFd >= 0) close(_instructionsFd);
+#endif
+}
+
+void Benchmark::startSample() {
+#ifdef BENCH_HOST
+    restartCounter(_cyclesFd);
+    restartCounter(_instructionsFd);
+    _startNanos = nowNanos();
+#else
+    _startCycles = ESP.getCycleCount();
+#endif
+}
+
+Benchmark::Sample Benchmark::stopSample() {
+    Sample sample;
+#ifdef BENCH_HOST
+    sample.nanos = nowNanos() - _startNanos;
+    sample.cycles = readCounter(_cyclesFd);
+    sample.instructions = readCounter(_instructionsFd);
+#else
+    // Unsigned difference survives one wrap of the 32 bit counter (about 17 s at 240 MHz)
+    sample.cycles = ESP.getCycleCount() - _startCycles;
+    sample.nanos = sample.cycles * 1000 / getCpuFrequencyMhz();
+    sample.instructions = 0;
+#endif
+    return sample;
+}
+
+bool Benchmark::hasCycles() const {
+#ifdef BENCH_HOST
+    return _cyclesFd >= 0;
+#else
+    return true;
+#endif
+}
+
+bool Benchmark::hasInstructions() const {
+    return _instructionsFd >= 0;
+}
+
+void Benchmark::report(const char* name, uint32_t iterations, Sample* samples) {
+    // Sort by time, a few samples are enough for insertion sort
+    for (uint8_t i = 1; i < SAMPLES; i++) {
+        Sample sample = samples[i];
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1].nanos > sample.nanos) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = sample;
+    }
+
+    const Sample& median = samples[SAMPLES / 2];
+    const Sample& best = samples[0];
+    const double count = iterations;
+
+    _output.printf("{\"target\":\"%s\",\"case\":\"%s\",\"iterations\":%lu,\"samples\":%u,\"ns_per_op\":%.2f,\"min_ns_per_op\":%.2f",
+                   _target, name, static_cast<unsigned long>(iterations), SAMPLES, median.nanos / count, best.nanos / count);
+    if (hasCycles()) {
+        _output.printf(",\"cycles_per_op\":%.2f", median.cycles / count);
+    } else {
+        _output.print(",\"cycles_per_op\":null");
+    }
+    if (hasInstructions()) {
+        _output.printf(",\"instructions_per_op\":%.2f", median.instructions / count);
+    } else {
+        _output.print(",\"instructions_per_op\":null");
+    }
+    _output.println("}");
+}
+
+void Benchmark::record(const char* name, const char* key, uint32_t value) {
+    _output.printf("{\"target\":\"%s\",\"case\":\"%s\",\"%s\":%lu}\n", _target, name, key, static_cast<unsigned long>(value));
+}
@@ -0,0 +1,61 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+// Microbenchmark harness. The same cases build for the ESP32, timed with the
+// CPU cycle counter, and for the Linux host, timed with a steady clock plus
+// perf counters where the kernel allows them. Every case prints one JSON line.
+class Benchmark {
+public:
+    static const uint8_t SAMPLES = 7;
+
+    Benchmark(Print& output, const char* target);
+    ~Benchmark();
+
+    // Times SAMPLES batches of iterations calls and reports the median and best batch
+    template <typename Body>
+    void run(const char* name, uint32_t iterations, Body body) {
+        body();  // Warm up caches and lazily initialised state
+        Sample samples[SAMPLES];
+        for (uint8_t s = 0; s < SAMPLES; s++) {
+            startSample();
+            for (uint32_t i = 0; i < iterations; i++) {
+                body();
+            }
+            samples[s] = stopSample();
+        }
+        report(name, iterations, samples);
+    }
+
+    // Prints a measured value that is not a time per operation, as its own JSON line
+    void record(const char* name, const char* key, uint32_t value);
+
+    // Keeps a result alive so the optimiser can not drop the work that produced it
+    template <typename T>
+    static inline void keep(const T& value) {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+
+private:
+    struct Sample {
+        uint64_t nanos;
+        uint64_t cycles;
+        uint64_t instructions;
+    };
+
+    Print& _output;
+    const char* _target;
+    uint64_t _startNanos;
+    uint32_t _startCycles;
+    int _cyclesFd;
+    int _instructionsFd;
+
+    void startSample();
+    Sample stopSample();
+    void report(const char* name, uint32_t iterations, Sample* samples);
+    bool hasCycles() const;
+    bool hasInstructions() const;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,457 @@
+#include "BenchmarkCases.h"
+#include "Timer.h"
+#include "PowerPolicy.h"
+#include "CaptiveDns.h"
+#include "LcdLayout.h"
+#include "InputBus.h"
+#include "RemoteControl.h"
+#include "StationScheduler.h"
+#include "MachineSnapshot.h"
+#include "TaskTable.h"
+#include "StrokeMotion.h"
+#include "SettingsSchema.h"
+#ifdef BENCH_HOST
+#include <atomic>
+#include <thread>
+#endif
+
+// Reaches the private members that the public API only calls indirectly
+class BenchmarkProbe {
+public:
+    static void fillBuffer(MatrixDisplay& display, const String& row1, const String& row2) {
+        display.fillBuffer(row1, row2);
+    }
+
+    static void displayCurrentMenuItem(Settings& settings) {
+        settings.invalidateRender();  // Time a real redraw, not the unchanged-screen shortcut
+        settings.displayCurrentMenuItem();
+    }
+
+    static void adjustValue(Settings& settings, int32_t steps) {
+        settings.adjustValue(steps);
+    }
+
+    static void flush(MatrixDisplay& display) {
+        display.updateChangedCharacters();
+    }
+
+#ifdef BENCH_HOST
+    static unsigned long busTransfers(MatrixDisplay& display) {
+        return display._lcd.transfers;
+    }
+#endif
+
+    // Enters a state and runs its entry code, so the timed calls only see the per-pass work
+    static void enterState(Station& station, SystemState state) {
+        station.changeState(state);
+        runState(station);
+    }
+
+    static void runState(Station& station) {
+        switch (station._state) {
+            case IDLE:
+                station.handleIdle();
+                break;
+            case RUNNING:
+                station.handleRunning(millis());
+                break;
+            case ERROR:
+                station.handleError();
+                break;
+            default:
+                station.update(millis());
+                break;
+        }
+    }
+};
+
+namespace {
+void noTimerAction(void*) {}
+
+void noTick(unsigned long) {}
+
+// Strokes that ended without a reversal when the stepper ran each one to its end
+// between two updates, as it can while the motion task steps on its own
+uint32_t countMissedReversals(uint8_t strokes, const Station::Pins& pins) {
+    MotionStepper stepper(pins.step, pins.dir);
+    StrokeMotion motion(stepper);
+    motion.configure(Steps(0), Steps(40), StepsPerSecond(5000), 5000.0f, 100000.0f);
+    motion.start();
+    uint32_t missed = 0;
+    for (uint8_t i = 0; i < strokes; i++) {
+        unsigned long before = motion.getStrokeCount();
+        while (stepper.run()) {}
+        motion.update();
+        if (motion.getStrokeCount() == before) {
+            missed++;
+        }
+    }
+    motion.halt();
+    return missed;
+}
+
+const uint32_t REFILL_PERIOD = 500;  // MotionTask::PERIOD, whose header only builds for the ESP32
+#ifndef BENCH_HOST
+static_assert(REFILL_PERIOD == MotionTask::PERIOD, "Keep the simulated refill period in step with the motion task");
+#endif
+
+// Steps that found the queue empty on a full-speed move, on simulated time, with
+// the queue refilled every REFILL_PERIOD except while the loop holds the station
+// for the first holdTime microseconds of every 20 ms
+uint32_t countQueueUnderruns(uint32_t holdTime, const Station::Pins& pins) {
+    const unsigned long HOLD_EVERY = 20000;  // µs
+    MotionStepper stepper(pins.step, pins.dir);
+    stepper.setQueued(true);
+    stepper.setMaxSpeed(SettingsSchema::SPEED_MAX);
+    stepper.setAcceleration(5000.0f);
+    stepper.setJerk(100000.0f);
+    stepper.moveTo(10000);
+    unsigned long now = 0;
+    unsigned long nextRefill = 0;
+    while (stepper.isRunning()) {
+        uint32_t wait = stepper.pulse(now);
+        if (wait != 0 && now + wait < nextRefill) {
+            now += wait;
+            continue;
+        }
+        now = nextRefill;
+        nextRefill += REFILL_PERIOD;
+        if (now % HOLD_EVERY >= holdTime) {
+            stepper.run();
+        }
+    }
+    return stepper.getUnderruns();
+}
+
+// Worst step lateness over a run of scheduler passes, best of a few runs so a single preemption does not count
+uint32_t measureStepLateness(StationScheduler& scheduler) {
+    const uint8_t RUNS = 3;
+    const uint32_t PASSES = 2000;
+    uint32_t best = UINT32_MAX;
+    for (uint8_t run = 0; run < RUNS; run++) {
+        scheduler.resetStats();
+        for (uint32_t pass = 0; pass < PASSES; pass++) {
+            scheduler.service(millis());
+        }
+        if (scheduler.getWorstStepLateness() < best) {
+            best = scheduler.getWorstStepLateness();
+        }
+    }
+    return best;
+}
+
+#ifdef BENCH_HOST
+// Reads that saw a snapshot mixed from two writes, while another thread publishes as fast as it can
+uint32_t countTornReads(uint32_t reads) {
+    static MachineSnapshotLock lock;  // Starts out all zero, which passes the check
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        MachineSnapshot snapshot = {};
+        while (!done.load(std::memory_order_relaxed)) {
+            snapshot.iteration++;
+            snapshot.time = snapshot.iteration;
+            for (uint8_t i = 0; i < StationScheduler::MAX_STATIONS; i++) {
+                snapshot.stations[i].position = snapshot.iteration;
+                snapshot.stations[i].target = snapshot.iteration;
+            }
+            lock.write(snapshot);
+        }
+    });
+
+    uint32_t torn = 0;
+    MachineSnapshot copy;
+    for (uint32_t i = 0; i < reads; i++) {
+        if (!lock.read(copy)) continue;
+        for (uint8_t s = 0; s < StationScheduler::MAX_STATIONS; s++) {
+            if (copy.stations[s].position != static_cast<int32_t>(copy.iteration) || copy.stations[s].target != static_cast<int32_t>(copy.time)) {
+                torn++;
+                break;
+            }
+        }
+    }
+    done = true;
+    writer.join();
+    return torn;
+}
+#endif
+}
+
+void runComponentBenchmarks(Benchmark& bench, ButtonHandler& button, MatrixDisplay& display, Settings& settings) {
+    bench.run("button_update", 10000, [&]() {
+        button.update();
+    });
+
+    // The input layer's share of a loop pass with nothing pressed
+    InputBus inputBus;
+    inputBus.addButton(button, InputEvent::SOURCE_START, 0, Station::PARK_PRESS_DURATION);
+    bench.run("input_bus_poll", 10000, [&]() {
+        inputBus.poll(millis());
+        InputEvent event;
+        while (inputBus.next(event)) {}
+    });
+
+    Timer timer;
+    timer.start(Millis(60000));
+    bench.run("timer_has_expired", 10000, [&]() {
+        bool expired = timer.hasExpired();
+        Benchmark::keep(expired);
+    });
+    bench.run("timer_remaining_time", 10000, [&]() {
+        unsigned long remaining = timer.getRemainingTime();
+        Benchmark::keep(remaining);
+    });
+
+    // Restarting a timer among others pending, as a state change does; the head stays put
+    const uint8_t PENDING_TIMERS = 8;
+    TimerService::TimerId pending[PENDING_TIMERS];
+    for (uint8_t i = 0; i < PENDING_TIMERS; i++) {
+        pending[i] = timerService.create(noTimerAction, NULL);
+        timerService.startOnce(pending[i], (i + 1) * 10000000ULL);
+    }
+    TimerService::TimerId restarted = timerService.create(noTimerAction, NULL);
+    bench.run("timer_service_restart", 10000, [&]() {
+        timerService.startOnce(restarted, 30000000ULL);
+    });
+    timerService.release(restarted);
+    for (uint8_t i = 0; i < PENDING_TIMERS; i++) {
+        timerService.release(pending[i]);
+    }
+
+    // The power decision made on every loop pass, with an input now and then
+    PowerPolicy power;
+    power.setProfile(0, PowerPolicy::PROFILE_SLEEP);
+    unsigned long now = 0;
+    bench.run("power_policy_update", 10000, [&]() {
+        now += 10;
+        power.update(0, (now % 5000) == 0, false, now);
+        Benchmark::keep(power.getCpuMhz());
+    });
+
+    // The task table's own cost on a pass where only the every-pass tick is due
+    TaskTable tasks;
+    tasks.add("motion", noTick, 0, TaskTable::PRIORITY_HIGH, 1000);
+    for (uint8_t i = 1; i < TaskTable::MAX_TASKS; i++) {
+        tasks.add("rate", noTick, 60000, TaskTable::PRIORITY_NORMAL, 1000);
+    }
+    tasks.run(millis(), 1000);  // Every tick runs on the first pass
+    bench.run("task_table_pass", 10000, [&]() {
+        tasks.run(millis(), 1000);
+    });
+
+    // Parsing and answering a set request, without the network
+    const uint8_t setRequest[] = {'S', 'K', RemoteControl::CMD_SET_SETTING, 7, RemoteControl::SETTING_SPEED, 0xa0, 0x0f, 0x00, 0x00};
+    bench.run("remote_decode_encode", 10000, [&]() {
+        RemoteControl::Request request;
+        RemoteControl::Status status = RemoteControl::decode(setRequest, sizeof(setRequest), request);
+        uint8_t reply[RemoteControl::MAX_PACKET_SIZE];
+        size_t length = RemoteControl::encodeReply(request, status, NULL, 0, reply);
+        Benchmark::keep(length);
+    });
+
+    // Answering a captive portal lookup, without the network
+    const uint8_t dnsQuery[] = {0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0,
+                                12, 'c', 'o', 'n', 'n', 'e', 'c', 't', 'i', 'v', 'i', 't', 'y',
+                                5, 'a', 'p', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0, 0, 1, 0, 1};
+    CaptiveDns dns;
+    bench.run("dns_build_response", 10000, [&]() {
+        uint8_t response[CaptiveDns::MAX_RESPONSE_SIZE];
+        Benchmark::keep(dns.buildResponse(dnsQuery, sizeof(dnsQuery), response));
+    });
+
+    const String row1 = "Time: 42s";
+    const String row2 = "Dist: 37.5mm";
+    bench.run("display_fill_buffer", 1000, [&]() {
+        BenchmarkProbe::fillBuffer(display, row1, row2);
+    });
+    bench.run("display_update", 1000, [&]() {
+        display.updateDisplay(row1, row2);
+    });
+
+    // The String building the running state did on every LCD refresh before LcdLayout
+    unsigned long seconds = 0;
+    bench.run("display_update_formatted", 1000, [&]() {
+        String timeStr = "Time: " + String(seconds++ % 120) + "s";
+        String distStr = "Dist: " + String(37.5f, 1) + "mm";
+        display.updateDisplay(timeStr, distStr);
+    });
+
+    // The running screen's refresh now: time changes every fourth pass, distance every pass
+    static const LcdLayout::Field runningFields[] = {
+        {LcdLayout::FIELD_NUMBER, 0, 5, 4, 0},
+        {LcdLayout::FIELD_BAR, 0, 10, 6, 0},
+        {LcdLayout::FIELD_NUMBER, 1, 5, 5, 1}
+    };
+    static const LcdLayout::Screen runningScreen = {"Time:    s", "Dist:     mm", runningFields, 3};
+    LcdLayout layout(display);
+    layout.show(runningScreen);
+    uint32_t refresh = 0;
+    auto refreshLayout = [&]() {
+        refresh++;
+        layout.set(0, 120 - (refresh / 4) % 120);
+        layout.set(1, (refresh * 2) % LcdLayout::PROGRESS_FULL);
+        layout.set(2, (refresh * 7) % 1000);
+    };
+    bench.run("layout_refresh", 1000, refreshLayout);
+
+#ifdef BENCH_HOST
+    // Commands and characters sent to the LCD per running refresh, a full redraw is 64
+    const uint32_t REFRESHES = 400;
+    BenchmarkProbe::flush(display);
+    unsigned long start = BenchmarkProbe::busTransfers(display);
+    for (uint32_t i = 0; i < REFRESHES; i++) {
+        refreshLayout();
+        BenchmarkProbe::flush(display);
+    }
+    bench.record("lcd_transfers_running_refresh", "per_refresh", (BenchmarkProbe::busTransfers(display) - start) / REFRESHES);
+#endif
+
+    settings.enter();
+    bench.run("settings_display_menu_item", 1000, [&]() {
+        BenchmarkProbe::displayCurrentMenuItem(settings);
+    });
+
+    // One detent back and forth on the cook time, drawn at most once per frame
+    int32_t detent = 1;
+    bench.run("settings_adjust_value", 1000, [&]() {
+        BenchmarkProbe::adjustValue(settings, detent);
+        detent = -detent;
+        settings.update();
+    });
+    settings.exit();
+}
+
+void runStationBenchmarks(Benchmark& bench, Settings& settings, const Station::Pins& pins) {
+#ifdef BENCH_HOST
+    hostSetPin(pins.endstop, LOW);  // The homing switch reads high when triggered
+#endif
+
+    // Per-iteration cost of the state handlers once past their entry code
+    Station station(0, pins, settings);
+    station.begin(NULL);
+
+    BenchmarkProbe::enterState(station, IDLE);
+    bench.run("state_idle", 1000, [&]() {
+        BenchmarkProbe::runState(station);
+    });
+
+    BenchmarkProbe::enterState(station, RUNNING);
+    bench.run("state_running", 1000, [&]() {
+        BenchmarkProbe::runState(station);
+    });
+
+    settings.enter();
+    bench.run("state_settings_menu", 1000, [&]() {
+        settings.update();
+    });
+    settings.exit();
+
+    station.fail("Benchmark", millis());
+    bench.run("state_error", 1000, [&]() {
+        BenchmarkProbe::runState(station);
+    });
+
+    // Scheduler passes with every station cooking, and the most stations that
+    // still keep each step within the lateness budget
+    const uint8_t STATION_COUNTS[] = {1, 2, 4, StationScheduler::MAX_STATIONS};
+    uint8_t capacity = 0;
+    for (uint8_t count : STATION_COUNTS) {
+        Station* stations[StationScheduler::MAX_STATIONS];
+        StationScheduler scheduler(StationScheduler::STEP_LATENESS_BUDGET);
+        for (uint8_t i = 0; i < count; i++) {
+            stations[i] = new Station(i, pins, settings);
+            stations[i]->begin(NULL);
+            scheduler.add(*stations[i]);
+            BenchmarkProbe::enterState(*stations[i], RUNNING);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "scheduler_pass_%u", count);
+        bench.run(name, 1000, [&]() {
+            scheduler.service(millis());
+        });
+
+        uint32_t lateness = measureStepLateness(scheduler);
+        snprintf(name, sizeof(name), "scheduler_lateness_%u", count);
+        bench.record(name, "worst_step_lateness_us", lateness);
+        if (lateness <= StationScheduler::STEP_LATENESS_BUDGET) {
+            capacity = count;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            stations[i]->fail("Benchmark", millis());
+            delete stations[i];
+        }
+    }
+    bench.record("scheduler_capacity", "stations", capacity);
+    bench.record("stroke_reversals_missed", "strokes", countMissedReversals(3, pins));
+    // The step queue against the longest loop pass that should not delay a step, and one past it
+    bench.record("step_queue_underruns_7ms", "underruns", countQueueUnderruns(7000, pins));
+    bench.record("step_queue_underruns_10ms", "underruns", countQueueUnderruns(10000, pins));
+
+    // Publishing a full snapshot each loop pass, and copying it out on the reader's side
+    static MachineSnapshot snapshot;
+    static MachineSnapshotLock lock;
+    snapshot.stationCount = StationScheduler::MAX_STATIONS;
+    bench.run("snapshot_publish", 1000, [&]() {
+        snapshot.iteration++;
+        snapshot.time = millis();
+        for (uint8_t i = 0; i < StationScheduler::MAX_STATIONS; i++) {
+            station.getStatus(snapshot.stations[i]);
+        }
+        lock.write(snapshot);
+    });
+
+    static MachineSnapshot copy;
+    bench.run("snapshot_read", 1000, [&]() {
+        lock.read(copy);
+    });
+
+#ifdef BENCH_HOST
+    bench.record("snapshot_torn_reads", "reads", countTornReads(200000));
+#endif
+}
+
+#ifndef BENCH_HOST
+void runMotionTaskBenchmarks(Benchmark& bench, MotionTask& motionTask, MatrixDisplay& display, Settings& settings, const Station::Pins& pins) {
+    // Outlive the call, the task keeps its scheduler
+    static StationScheduler scheduler(StationScheduler::STEP_LATENESS_BUDGET);
+    static Station station(0, pins, settings);
+    station.begin(NULL);
+    scheduler.add(station);
+    if (!motionTask.begin(scheduler)) {
+        bench.record("motion_task_started", "ok", 0);
+        return;
+    }
+    scheduler.setMotionPolling(false);
+
+    // One station cooking; each loop pass also formats a display line and spends 200 µs on other work
+    BenchmarkProbe::enterState(station, RUNNING);
+    station.resetStepLateness();
+    motionTask.setRunning(true);
+    motionTask.resetStats();
+    const unsigned long DURATION = 2000;  // ms
+    unsigned long start = millis();
+    uint32_t pass = 0;
+    char row[MatrixDisplay::MAX_COLS + 1];
+    while (millis() - start < DURATION) {
+        scheduler.service(millis());
+        snprintf(row, sizeof(row), "Pass %lu", static_cast<unsigned long>(pass++));
+        display.updateDisplay("Motion bench", row);
+        delayMicroseconds(200);
+    }
+    MotionTask::Stats stats;
+    motionTask.getStats(stats);
+    motionTask.setRunning(false);
+    station.fail("Benchmark", millis());
+
+    bench.record("motion_ticks", "ticks", stats.ticks);
+    bench.record("motion_jitter_worst", "worst_us", stats.worstJitter);
+    bench.record("motion_jitter_mean", "mean_us", stats.meanJitter);
+    bench.record("motion_missed_ticks", "ticks", stats.missedTicks);
+    bench.record("motion_tick_worst", "worst_us", stats.worstDuration);
+    bench.record("motion_step_lateness", "worst_step_lateness_us", station.getStepLateness());
+    bench.record("motion_step_underruns", "underruns", station.getStepUnderruns());
+    bench.record("motion_interrupts", "interrupts", stats.interrupts);
+    bench.record("motion_interrupt_worst", "worst_us", stats.worstInterrupt);
+}
+#endif
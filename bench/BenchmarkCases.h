@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_CASES_H
+#define BENCHMARK_CASES_H
+
+#include "Benchmark.h"
+#include "ButtonHandler.h"
+#include "MatrixDisplay.h"
+#include "Settings.h"
+#include "Station.h"
+
+// Cases for the classes that build on both the host and the ESP32
+void runComponentBenchmarks(Benchmark& bench, ButtonHandler& button, MatrixDisplay& display, Settings& settings);
+
+// State handler costs and the multi-station scheduler, stations built on the given pins
+void runStationBenchmarks(Benchmark& bench, Settings& settings, const Station::Pins& pins);
+
+#ifndef BENCH_HOST
+#include "MotionTask.h"
+
+// Motion task jitter while the loop is busy, needs the hardware timer so ESP32 only
+void runMotionTaskBenchmarks(Benchmark& bench, MotionTask& motionTask, MatrixDisplay& display, Settings& settings, const Station::Pins& pins);
+#endif
+
+#endif // BENCHMARK_CASES_H
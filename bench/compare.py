@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Compare two benchmark runs and flag hot-path regressions.
+
+Usage: compare.py BASELINE CANDIDATE [--threshold PERCENT]
+
+Both files hold the JSON lines printed by the benchmark builds, other serial
+output is ignored. Exits with status 1 when any case got slower than the
+threshold (default 10%).
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                entry = json.loads(line)
+            except ValueError:
+                continue
+            # Summary lines such as the station capacity carry no timing to compare
+            if "ns_per_op" not in entry:
+                continue
+            results[(entry["target"], entry["case"])] = entry
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed slowdown in percent")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    candidate = load(args.candidate)
+    regressions = 0
+
+    print("%-8s %-28s %12s %12s %8s" % ("target", "case", "base ns", "new ns", "change"))
+    for key in sorted(set(baseline) | set(candidate)):
+        if key not in baseline or key not in candidate:
+            print("%-8s %-28s %s" % (key[0], key[1], "only in " + ("candidate" if key in candidate else "baseline")))
+            continue
+        # Median per batch, cycles where available since they ignore clock scaling
+        metric = "cycles_per_op" if baseline[key]["cycles_per_op"] is not None and candidate[key]["cycles_per_op"] is not None else "ns_per_op"
+        old = baseline[key][metric]
+        new = candidate[key][metric]
+        change = (new - old) / old * 100.0 if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-8s %-28s %12.2f %12.2f %+7.1f%%%s" % (key[0], key[1], baseline[key]["ns_per_op"], candidate[key]["ns_per_op"], change, flag))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,108 @@
+#ifndef BENCH_HOST_ARDUINO_H
+#define BENCH_HOST_ARDUINO_H
+
+// Minimal Arduino core for building the firmware sources on the Linux host.
+// Only what the benchmarked classes use is provided.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+// Sets the level digitalRead() returns for a pin, pins read HIGH by default
+void hostSetPin(uint8_t pin, int level);
+
+// Time behind millis(), micros() and esp_timer. Replays switch to a virtual
+// clock at startup, which starts at zero and only moves through
+// hostAdvanceClock() and delay(). Advancing fires the esp_timer callbacks
+// that fall due, in order, on the calling thread.
+uint64_t hostClockMicros();
+bool hostClockIsVirtual();
+void hostUseVirtualClock();
+void hostAdvanceClock(uint64_t us);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t print(const char* text);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(int value) { return print(static_cast<long>(value)); }
+    size_t print(unsigned int value) { return print(static_cast<unsigned long>(value)); }
+    size_t print(double value, int digits = 2);
+    size_t println();
+    template <typename T>
+    size_t println(T value) { size_t n = print(value); return n + println(); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// Arduino String on top of std::string, with the same number formatting
+class String {
+public:
+    String() {}
+    String(const char* text) : _text(text ? text : "") {}
+    String(const std::string& text) : _text(text) {}
+    String(char c) : _text(1, c) {}
+    String(int value);
+    String(unsigned int value);
+    String(long value);
+    String(unsigned long value);
+    String(float value, unsigned int decimals = 2);
+    String(double value, unsigned int decimals = 2);
+
+    unsigned int length() const { return _text.length(); }
+    const char* c_str() const { return _text.c_str(); }
+    char* begin() { return &_text[0]; }
+    char* end() { return &_text[0] + _text.length(); }
+    const char* begin() const { return _text.data(); }
+    const char* end() const { return _text.data() + _text.length(); }
+
+    String& operator+=(const String& other) { _text += other._text; return *this; }
+    bool operator==(const String& other) const { return _text == other._text; }
+    bool operator!=(const String& other) const { return _text != other._text; }
+    friend String operator+(const String& a, const String& b) { return String(a._text + b._text); }
+    friend String operator+(const String& a, const char* b) { return String(a._text + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._text); }
+
+private:
+    std::string _text;
+};
+
+#endif // BENCH_HOST_ARDUINO_H
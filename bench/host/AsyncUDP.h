@@ -0,0 +1,23 @@
+#ifndef BENCH_HOST_ASYNC_UDP_H
+#define BENCH_HOST_ASYNC_UDP_H
+
+#include "Arduino.h"
+#include "WiFiUdp.h"
+
+// Just enough of AsyncUDP to build CaptiveDns; the host cases call buildResponse() directly
+class AsyncUDPPacket {
+public:
+    uint8_t* data() { return NULL; }
+    size_t length() { return 0; }
+    size_t write(const uint8_t*, size_t) { return 0; }
+};
+
+class AsyncUDP {
+public:
+    typedef void (*Handler)(void* arg, AsyncUDPPacket& packet);
+    bool listen(uint16_t) { return false; }
+    void close() {}
+    void onPacket(Handler, void* = NULL) {}
+};
+
+#endif // BENCH_HOST_ASYNC_UDP_H
@@ -0,0 +1,31 @@
+#ifndef BENCH_HOST_ESP32_ENCODER_H
+#define BENCH_HOST_ESP32_ENCODER_H
+
+#include <Arduino.h>
+
+enum puType { UP, DOWN, NONE };
+typedef void (*enc_isr_cb_t)(void*);
+
+// Encoder with a count that only changes through setCount(), which raises
+// the count change callback like the PCNT interrupt would
+class ESP32Encoder {
+public:
+    static puType useInternalWeakPullResistors;
+    ESP32Encoder(bool alwaysInterrupt = false, enc_isr_cb_t callback = nullptr, void* callbackData = nullptr)
+        : _callback(alwaysInterrupt ? callback : nullptr), _callbackData(callbackData) {}
+    void attachHalfQuad(int aPin, int bPin) { (void)aPin; (void)bPin; hostAttached = this; }
+    int64_t getCount() { return _count; }
+    void setCount(int64_t value) { _count = value; if (_callback) _callback(_callbackData); }
+    int64_t clearCount() { setCount(0); return 0; }
+
+    // Turns the encoder attached last, as a replayed knob would
+    static ESP32Encoder* hostAttached;
+    static void hostTurn(int64_t counts) { if (hostAttached && counts != 0) hostAttached->setCount(hostAttached->getCount() + counts); }
+
+private:
+    int64_t _count = 0;
+    enc_isr_cb_t _callback;
+    void* _callbackData;
+};
+
+#endif // BENCH_HOST_ESP32_ENCODER_H
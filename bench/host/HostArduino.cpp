@@ -0,0 +1,131 @@
+#include "Arduino.h"
+#include "ESP32Encoder.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+namespace {
+uint8_t pinLevels[64];
+bool pinLevelsSet[64];
+
+std::string formatNumber(const char* format, ...) {
+    char buffer[48];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return buffer;
+}
+}
+
+unsigned long millis() {
+    return hostClockMicros() / 1000;
+}
+
+unsigned long micros() {
+    return hostClockMicros();
+}
+
+void delay(unsigned long ms) {
+    if (hostClockIsVirtual()) {
+        hostAdvanceClock(ms * 1000ULL);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Busy-waits like the ESP32 core does, a sleep lasts tens of microseconds on Linux
+void delayMicroseconds(unsigned int us) {
+    if (hostClockIsVirtual()) {
+        hostAdvanceClock(us);
+        return;
+    }
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= sizeof(pinLevels) || !pinLevelsSet[pin]) return HIGH;
+    return pinLevels[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    hostSetPin(pin, value);
+}
+
+void hostSetPin(uint8_t pin, int level) {
+    if (pin >= sizeof(pinLevels)) return;
+    pinLevels[pin] = level ? HIGH : LOW;
+    pinLevelsSet[pin] = true;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(const char* text) {
+    return write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+size_t Print::print(long value) {
+    return print(formatNumber("%ld", value).c_str());
+}
+
+size_t Print::print(unsigned long value) {
+    return print(formatNumber("%lu", value).c_str());
+}
+
+size_t Print::print(double value, int digits) {
+    return print(formatNumber("%.*f", digits, value).c_str());
+}
+
+size_t Print::println() {
+    return print("\r\n");
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(reinterpret_cast<const uint8_t*>(buffer), std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+String::String(int value) : _text(formatNumber("%d", value)) {}
+String::String(unsigned int value) : _text(formatNumber("%u", value)) {}
+String::String(long value) : _text(formatNumber("%ld", value)) {}
+String::String(unsigned long value) : _text(formatNumber("%lu", value)) {}
+String::String(float value, unsigned int decimals) : _text(formatNumber("%.*f", decimals, value)) {}
+String::String(double value, unsigned int decimals) : _text(formatNumber("%.*f", decimals, value)) {}
+
+puType ESP32Encoder::useInternalWeakPullResistors = UP;
+ESP32Encoder* ESP32Encoder::hostAttached = nullptr;
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
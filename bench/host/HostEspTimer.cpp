@@ -0,0 +1,170 @@
+#include "esp_timer.h"
+#include "Arduino.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+namespace {
+const Clock::time_point startTime = Clock::now();
+std::atomic<bool> virtualClock(false);
+std::atomic<uint64_t> virtualMicros(0);
+}
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t deadline;  // On hostClockMicros()
+    uint64_t period;    // Microseconds, 0 for one-shot
+    bool armed;
+    bool exiting;
+    std::thread thread;
+};
+
+namespace {
+// Every live timer, for hostAdvanceClock()
+std::mutex timersMutex;
+std::vector<esp_timer*> timers;
+
+void runTimer(esp_timer* timer) {
+    std::unique_lock<std::mutex> lock(timer->mutex);
+    while (!timer->exiting) {
+        // On the virtual clock, hostAdvanceClock() fires the timers instead
+        if (!timer->armed || virtualClock) {
+            timer->changed.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline = startTime + std::chrono::microseconds(timer->deadline);
+        if (timer->changed.wait_until(lock, deadline) != std::cv_status::timeout || !timer->armed || virtualClock ||
+            Clock::now() < deadline) {
+            continue;  // Restarted, stopped or woken early
+        }
+        if (timer->period > 0) {
+            timer->deadline += timer->period;
+        } else {
+            timer->armed = false;
+        }
+        lock.unlock();
+        timer->callback(timer->arg);
+        lock.lock();
+    }
+}
+
+esp_err_t start(esp_timer_handle_t timer, uint64_t timeout, uint64_t period) {
+    if (timer == nullptr) return ESP_FAIL;
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    timer->deadline = hostClockMicros() + timeout;
+    timer->period = period;
+    timer->armed = true;
+    timer->changed.notify_one();
+    return ESP_OK;
+}
+
+// Disarms or rearms the earliest timer due by limit and returns it, nullptr if none is
+esp_timer* takeDueTimer(uint64_t limit) {
+    std::lock_guard<std::mutex> listLock(timersMutex);
+    esp_timer* due = nullptr;
+    uint64_t dueTime = limit;
+    for (esp_timer* timer : timers) {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        if (timer->armed && timer->deadline <= dueTime) {
+            due = timer;
+            dueTime = timer->deadline;
+        }
+    }
+    if (due != nullptr) {
+        std::lock_guard<std::mutex> lock(due->mutex);
+        virtualMicros = due->deadline;
+        if (due->period > 0) {
+            due->deadline += due->period;
+        } else {
+            due->armed = false;
+        }
+    }
+    return due;
+}
+}
+
+uint64_t hostClockMicros() {
+    if (virtualClock) return virtualMicros;
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime).count();
+}
+
+bool hostClockIsVirtual() {
+    return virtualClock;
+}
+
+// Starts at zero, so every replay sees the same times; call before any timer is created
+void hostUseVirtualClock() {
+    virtualMicros = 0;
+    virtualClock = true;
+}
+
+// Callbacks run on the caller's thread in deadline order, each with the clock at its deadline
+void hostAdvanceClock(uint64_t us) {
+    if (!virtualClock) return;
+    uint64_t target = virtualMicros + us;
+    while (esp_timer* timer = takeDueTimer(target)) {
+        timer->callback(timer->arg);
+    }
+    virtualMicros = target;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    esp_timer* timer = new esp_timer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->deadline = 0;
+    timer->period = 0;
+    timer->armed = false;
+    timer->exiting = false;
+    timer->thread = std::thread(runTimer, timer);
+    {
+        std::lock_guard<std::mutex> lock(timersMutex);
+        timers.push_back(timer);
+    }
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout) {
+    return start(timer, timeout, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == nullptr) return ESP_FAIL;
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    timer->armed = false;
+    timer->changed.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == nullptr) return ESP_FAIL;
+    {
+        std::lock_guard<std::mutex> lock(timersMutex);
+        timers.erase(std::find(timers.begin(), timers.end(), timer));
+    }
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        timer->exiting = true;
+        timer->changed.notify_one();
+    }
+    timer->thread.join();
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return hostClockMicros();
+}
@@ -0,0 +1,78 @@
+#include "WiFiUdp.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiUDP::WiFiUDP()
+    : _socket(-1), _rxLength(0), _rxPosition(0), _remoteAddress(0), _remotePort(0), _txLength(0), _txAddress(0), _txPort(0) {}
+
+WiFiUDP::~WiFiUDP() {
+    stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0) return 0;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (_socket >= 0) close(_socket);
+    _socket = -1;
+}
+
+// Non-blocking like the ESP32 core: 0 when nothing has arrived
+int WiFiUDP::parsePacket() {
+    if (_socket < 0) return 0;
+    sockaddr_in sender = {};
+    socklen_t senderLength = sizeof(sender);
+    ssize_t length = recvfrom(_socket, _rxBuffer, sizeof(_rxBuffer), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&sender), &senderLength);
+    if (length <= 0) return 0;
+    _rxLength = length;
+    _rxPosition = 0;
+    _remoteAddress = sender.sin_addr.s_addr;
+    _remotePort = ntohs(sender.sin_port);
+    return length;
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t length) {
+    size_t available = _rxLength - _rxPosition;
+    if (length > available) length = available;
+    memcpy(buffer, &_rxBuffer[_rxPosition], length);
+    _rxPosition += length;
+    return length;
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+    _txAddress = address;
+    _txPort = port;
+    _txLength = 0;
+    return _socket >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t length) {
+    if (length > sizeof(_txBuffer) - _txLength) length = sizeof(_txBuffer) - _txLength;
+    memcpy(&_txBuffer[_txLength], buffer, length);
+    _txLength += length;
+    return length;
+}
+
+int WiFiUDP::endPacket() {
+    sockaddr_in destination = {};
+    destination.sin_family = AF_INET;
+    destination.sin_addr.s_addr = _txAddress;
+    destination.sin_port = htons(_txPort);
+    ssize_t sent = sendto(_socket, _txBuffer, _txLength, 0, reinterpret_cast<sockaddr*>(&destination), sizeof(destination));
+    return sent == static_cast<ssize_t>(_txLength) ? 1 : 0;
+}
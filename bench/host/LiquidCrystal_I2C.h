@@ -0,0 +1,22 @@
+#ifndef BENCH_HOST_LIQUID_CRYSTAL_I2C_H
+#define BENCH_HOST_LIQUID_CRYSTAL_I2C_H
+
+#include <Arduino.h>
+
+// Display without a bus, so host timings cover only the firmware side. Counts
+// the commands and characters that would go over the bus.
+class LiquidCrystal_I2C : public Print {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows) : transfers(0) { (void)address; (void)cols; (void)rows; }
+    void init() {}
+    void backlight() {}
+    void clear() { transfers++; }
+    void setCursor(uint8_t col, uint8_t row) { (void)col; (void)row; transfers++; }
+    void createChar(uint8_t slot, uint8_t pattern[]) { (void)slot; (void)pattern; transfers += 9; }
+    size_t write(uint8_t c) override { (void)c; transfers++; return 1; }
+    using Print::write;
+
+    unsigned long transfers;
+};
+
+#endif // BENCH_HOST_LIQUID_CRYSTAL_I2C_H
@@ -0,0 +1,24 @@
+#ifndef BENCH_HOST_MD5_BUILDER_H
+#define BENCH_HOST_MD5_BUILDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The part of the Arduino MD5Builder the host build uses, MD5 as in RFC 1321
+class MD5Builder {
+public:
+    void begin();
+    void add(const uint8_t* data, uint16_t length);
+    void calculate();
+    void getBytes(uint8_t* output) const;
+
+private:
+    uint32_t _state[4];
+    uint64_t _length;  // Bytes added so far
+    uint8_t _block[64];
+    uint8_t _digest[16];
+
+    void transform(const uint8_t* block);
+};
+
+#endif // BENCH_HOST_MD5_BUILDER_H
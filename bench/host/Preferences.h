@@ -0,0 +1,31 @@
+#ifndef BENCH_HOST_PREFERENCES_H
+#define BENCH_HOST_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+
+// Non-volatile storage kept in memory for the lifetime of the process
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) { _namespace = name; (void)readOnly; return true; }
+    void end() {}
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    size_t putULong(const char* key, uint32_t value) { store()[_namespace + "/" + key] = value; return sizeof(value); }
+    float getFloat(const char* key, float defaultValue = 0) { return static_cast<float>(get(key, defaultValue)); }
+    size_t putFloat(const char* key, float value) { store()[_namespace + "/" + key] = value; return sizeof(value); }
+
+private:
+    std::string _namespace;
+
+    static std::map<std::string, double>& store() {
+        static std::map<std::string, double> values;
+        return values;
+    }
+
+    double get(const char* key, double defaultValue) {
+        std::map<std::string, double>::const_iterator it = store().find(_namespace + "/" + key);
+        return it == store().end() ? defaultValue : it->second;
+    }
+};
+
+#endif // BENCH_HOST_PREFERENCES_H
@@ -0,0 +1,105 @@
+#include "RemoteLoopback.h"
+#include "RemoteControl.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+// Client socket connected to the RemoteControl port on 127.0.0.1, -1 on failure
+int openClient(uint16_t port) {
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client < 0) return -1;
+
+    timeval timeout = {1, 0};  // A lost reply fails the case instead of hanging it
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(port);
+    if (connect(client, reinterpret_cast<sockaddr*>(&server), sizeof(server)) != 0) {
+        close(client);
+        return -1;
+    }
+    return client;
+}
+
+// Polls like the loop does until the request is queued, then answers it the way main.cpp does
+void serve(RemoteControl& remote) {
+    RemoteControl::Request request;
+    while (!remote.nextRequest(request)) {
+        remote.poll();
+    }
+    if (request.command == RemoteControl::CMD_GET_STATUS) {
+        remote.replyStatus(request, 2, false, 0, 0);
+    } else if (request.command == RemoteControl::CMD_SET_SETTING) {
+        remote.replyValue(request, RemoteControl::STATUS_OK, request.value);
+    } else {
+        remote.reply(request, RemoteControl::STATUS_OK);
+    }
+}
+
+// One request and its reply, false when the reply is missing or does not match
+bool roundTrip(int client, RemoteControl& remote, const uint8_t* request, size_t length) {
+    if (send(client, request, length, 0) != static_cast<ssize_t>(length)) return false;
+    serve(remote);
+    uint8_t reply[RemoteControl::MAX_PACKET_SIZE];
+    ssize_t received = recv(client, reply, sizeof(reply), 0);
+    return received > RemoteControl::HEADER_SIZE && reply[0] == 'S' && reply[1] == 'K' && reply[2] == (request[2] | 0x80) &&
+           reply[3] == request[3] && reply[4] == RemoteControl::STATUS_OK;
+}
+}
+
+void runRemoteBenchmarks(Benchmark& bench) {
+    RemoteControl remote;
+    if (!remote.begin("bench", RemoteControl::DEFAULT_PORT)) {
+        fprintf(stderr, "remote: port %u not available, skipping\n", RemoteControl::DEFAULT_PORT);
+        return;
+    }
+    int client = openClient(RemoteControl::DEFAULT_PORT);
+    if (client < 0) {
+        fprintf(stderr, "remote: no loopback client, skipping\n");
+        return;
+    }
+
+    uint32_t failures = 0;
+    uint8_t status[] = {'S', 'K', RemoteControl::CMD_GET_STATUS, 0};
+    bench.run("remote_round_trip_status", 1000, [&]() {
+        status[3]++;
+        if (!roundTrip(client, remote, status, sizeof(status))) failures++;
+    });
+
+    // Cook time 45 s, signed with a new counter each time as a client does
+    uint8_t set[RemoteControl::MAX_PACKET_SIZE] = {'S', 'K', RemoteControl::CMD_SET_SETTING, 0, RemoteControl::SETTING_COOK_TIME,
+                                                   0xc8, 0xaf, 0x00, 0x00};
+    uint32_t counter = 0;
+    bench.run("remote_round_trip_set", 1000, [&]() {
+        set[3]++;
+        size_t length = remote.sign(set, 9, ++counter);
+        if (!roundTrip(client, remote, set, length)) failures++;
+    });
+
+    // A replayed request is answered without reaching the queue
+    bool replayRejected = false;
+    if (send(client, set, RemoteControl::HEADER_SIZE + 5 + RemoteControl::AUTH_SIZE, 0) > 0) {
+        uint8_t reply[RemoteControl::MAX_PACKET_SIZE];
+        RemoteControl::Request request;
+        ssize_t received = -1;
+        for (uint8_t i = 0; i < 100 && received < 0; i++) {
+            remote.poll();
+            received = recv(client, reply, sizeof(reply), MSG_DONTWAIT);
+            usleep(1000);
+        }
+        replayRejected = received > RemoteControl::HEADER_SIZE && reply[4] == RemoteControl::STATUS_UNAUTHORIZED &&
+                         !remote.nextRequest(request);
+    }
+    bench.record("remote_replay_rejected", "ok", replayRejected ? 1 : 0);
+
+    if (failures > 0) {
+        fprintf(stderr, "remote: %u round trips failed\n", static_cast<unsigned>(failures));
+    }
+    close(client);
+}
@@ -0,0 +1,9 @@
+#ifndef BENCH_HOST_REMOTE_LOOPBACK_H
+#define BENCH_HOST_REMOTE_LOOPBACK_H
+
+#include "Benchmark.h"
+
+// Round trips of the remote protocol between a loopback client and RemoteControl, host only
+void runRemoteBenchmarks(Benchmark& bench);
+
+#endif // BENCH_HOST_REMOTE_LOOPBACK_H
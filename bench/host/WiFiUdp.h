@@ -0,0 +1,47 @@
+#ifndef BENCH_HOST_WIFI_UDP_H
+#define BENCH_HOST_WIFI_UDP_H
+
+#include "Arduino.h"
+
+// Address in network byte order, as the ESP32 core stores it
+class IPAddress {
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    operator uint32_t() const { return _address; }
+
+private:
+    uint32_t _address;
+};
+
+// WiFiUDP on a POSIX datagram socket, so the remote protocol can be driven over loopback
+class WiFiUDP {
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+    uint8_t begin(uint16_t port);
+    void stop();
+    int parsePacket();
+    int read(uint8_t* buffer, size_t length);
+    IPAddress remoteIP() const { return IPAddress(_remoteAddress); }
+    uint16_t remotePort() const { return _remotePort; }
+    int beginPacket(IPAddress address, uint16_t port);
+    size_t write(const uint8_t* buffer, size_t length);
+    int endPacket();
+
+private:
+    static const size_t BUFFER_SIZE = 1472;
+
+    int _socket;
+    uint8_t _rxBuffer[BUFFER_SIZE];
+    size_t _rxLength;
+    size_t _rxPosition;
+    uint32_t _remoteAddress;
+    uint16_t _remotePort;
+    uint8_t _txBuffer[BUFFER_SIZE];
+    size_t _txLength;
+    uint32_t _txAddress;
+    uint16_t _txPort;
+};
+
+#endif // BENCH_HOST_WIFI_UDP_H
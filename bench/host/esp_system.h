@@ -0,0 +1,38 @@
+#ifndef BENCH_HOST_ESP_SYSTEM_H
+#define BENCH_HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include <chrono>
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+} esp_reset_reason_t;
+
+// No RTC memory on the host, the record is an ordinary variable
+#define RTC_NOINIT_ATTR
+
+// Every host run is a cold start, so no stored position survives it
+inline esp_reset_reason_t esp_reset_reason() {
+    return ESP_RST_POWERON;
+}
+
+// Not a hardware RNG, but different on every run
+inline uint32_t esp_random() {
+    static uint32_t state = static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+#endif // BENCH_HOST_ESP_SYSTEM_H
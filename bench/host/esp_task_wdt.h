@@ -0,0 +1,12 @@
+#ifndef BENCH_HOST_ESP_TASK_WDT_H
+#define BENCH_HOST_ESP_TASK_WDT_H
+
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+// No watchdog on the host
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { (void)timeout; (void)panic; return ESP_FAIL; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_FAIL; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_FAIL; }
+
+#endif // BENCH_HOST_ESP_TASK_WDT_H
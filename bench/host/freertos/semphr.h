@@ -0,0 +1,54 @@
+#ifndef BENCH_HOST_FREERTOS_SEMPHR_H
+#define BENCH_HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+#include <chrono>
+#include <mutex>
+
+// Recursive for both kinds, plain mutexes are never taken twice by the firmware
+struct HostSemaphore {
+    std::recursive_timed_mutex mutex;
+    bool dynamic;
+};
+
+typedef HostSemaphore* SemaphoreHandle_t;
+typedef HostSemaphore StaticSemaphore_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    HostSemaphore* semaphore = new HostSemaphore();
+    semaphore->dynamic = true;
+    return semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) {
+    buffer->dynamic = false;
+    return buffer;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t* buffer) {
+    return xSemaphoreCreateMutexStatic(buffer);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    if (semaphore->dynamic) delete semaphore;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) { semaphore->mutex.unlock(); return pdTRUE; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    return xSemaphoreTake(semaphore, ticks);
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    return xSemaphoreGive(semaphore);
+}
+
+#endif // BENCH_HOST_FREERTOS_SEMPHR_H
@@ -0,0 +1,29 @@
+#ifndef BENCH_HOST_FREERTOS_TASK_H
+#define BENCH_HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+struct StaticTask_t {
+    void* reserved;
+};
+
+// Tasks are never started on the host, benchmarks drive the code directly
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                          UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    (void)function; (void)name; (void)stackDepth; (void)parameter; (void)priority; (void)core;
+    if (handle) *handle = nullptr;
+    return pdFAIL;
+}
+
+inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                                                  UBaseType_t priority, StackType_t* stack, StaticTask_t* taskBuffer, BaseType_t core) {
+    (void)function; (void)name; (void)stackDepth; (void)parameter; (void)priority; (void)stack; (void)taskBuffer; (void)core;
+    return nullptr;
+}
+
+inline void vTaskDelete(TaskHandle_t task) { (void)task; }
+void vTaskDelay(TickType_t ticks);
+
+#endif // BENCH_HOST_FREERTOS_TASK_H
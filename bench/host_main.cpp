@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include "BenchmarkCases.h"
+#include "RemoteLoopback.h"
+
+// Globals the firmware sources expect from main.cpp
+RotaryInput rotary;
+TimerService timerService;
+
+int main() {
+    timerService.begin();
+    ButtonHandler button(15, "Start");
+    MatrixDisplay display(0x27, 16, 2);
+    Settings settings(display, rotary);
+    settings.loadSettingsFromPreferences();
+
+    Benchmark bench(Serial, "host");
+    runComponentBenchmarks(bench, button, display, settings);
+
+    // Same pin numbers as the firmware, only the simulated levels change
+    const Station::Pins pins = {13, 12, 27, 14, 16, 15, 2};
+    runStationBenchmarks(bench, settings, pins);
+    runRemoteBenchmarks(bench);
+    return 0;
+}
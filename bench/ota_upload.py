@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Upload a firmware image to the machine, deflate-compressed by default.
+
+Usage: ota_upload.py [--host HOST] [--password PASSWORD] [--raw] FIRMWARE.bin
+
+Sends the OTA mode command first, signed with the password, which stops every
+station unless one cooks or moves, then the image
+over TCP. The machine checks the MD5 of the inflated image and restarts into
+it. Connect to the Skumfidus access point first.
+"""
+import argparse
+import hashlib
+import socket
+import struct
+import sys
+import time
+import zlib
+
+from remote_client import COMMANDS, STATUS_NAMES, Client
+
+OTA_PORT = 3233
+FORMAT_RAW = 0
+FORMAT_DEFLATE = 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=OTA_PORT)
+    parser.add_argument("--remote-port", type=int, default=4210)
+    parser.add_argument("--password", default="OrangeMakers", help="the firmware's OTA password")
+    parser.add_argument("--raw", action="store_true", help="send the image uncompressed")
+    parser.add_argument("firmware")
+    args = parser.parse_args()
+
+    with open(args.firmware, "rb") as f:
+        image = f.read()
+    payload = image if args.raw else zlib.compress(image, 9)
+    digest = hashlib.md5(image).digest()
+    auth = hashlib.md5(args.password.encode() + digest).digest()
+    header = b"SKOT" + bytes([FORMAT_RAW if args.raw else FORMAT_DEFLATE, 0, 0, 0])
+    header += struct.pack("<II", len(image), len(payload)) + digest + auth
+
+    status, _ = Client(args.host, args.remote_port, 1.0, args.password).request(COMMANDS["ota"])
+    if status != 0:
+        print("OTA mode %s, wait until no station cooks or moves" % STATUS_NAMES.get(status, status), file=sys.stderr)
+        return 1
+
+    print("image %d bytes, sending %d bytes (%.0f%%)" % (len(image), len(payload), 100.0 * len(payload) / len(image)))
+    start = time.perf_counter()
+    with socket.create_connection((args.host, args.port), timeout=30) as sock:
+        sock.sendall(header + payload)
+        reply = sock.makefile("r").readline().strip()
+    elapsed = time.perf_counter() - start
+    print("%s after %.1f s, %.1f KB/s of image" % (reply or "no reply", elapsed, len(image) / 1024.0 / elapsed))
+    return 0 if reply == "OK" else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
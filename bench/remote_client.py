@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Send remote protocol commands to the machine and measure round trips.
+
+Usage: remote_client.py [--host HOST] [--port PORT] [--password PASSWORD] COMMAND [ARGS]
+
+Commands: start, abort, park, status, settings, set NAME VALUE, ping [COUNT], log, ota, trace
+Setting names: cook_time (ms), total_distance (um), speed (steps/s).
+log prints the cycle log as CSV, one request per record.
+ota stops every station and waits for a firmware upload, see ota_upload.py; not during a cook or a move.
+trace makes the machine print its input trace on the serial port, see bench/replay.
+start, park, set and ota are signed with the firmware's OTA password.
+Connect to the Skumfidus access point first, the machine is at 192.168.4.1.
+"""
+import argparse
+import hashlib
+import hmac
+import socket
+import statistics
+import struct
+import sys
+import time
+import zlib
+
+COMMANDS = {"start": 0x01, "abort": 0x02, "park": 0x03, "status": 0x04, "settings": 0x05, "set": 0x06, "log": 0x07,
+            "ota": 0x08, "trace": 0x09}
+SETTINGS = {"cook_time": 0, "total_distance": 1, "speed": 2}
+STATUS_NAMES = {0: "ok", 1: "rejected", 2: "busy", 3: "bad request", 4: "unauthorized"}
+STATUS_UNAUTHORIZED = 4
+END_REASONS = ["done", "aborted", "remote", "error"]
+LOG_RECORD = struct.Struct("<2sBBIHBBIIIHHIIII")
+LOG_FIELDS = ["sequence", "boot", "station", "end", "start_ms", "cook_time_ms", "total_distance_um", "speed",
+              "strokes", "duration_ms", "heater_on_ms", "peak_latency_us"]
+STATE_NAMES = ["STARTUP", "HOMING", "IDLE", "RUNNING", "RETURNING_TO_START", "ERROR", "SETTINGS_MENU", "PARKING"]
+
+
+class Client:
+    def __init__(self, host, port, timeout, password="OrangeMakers"):
+        self.address = (host, port)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.sequence = 0
+        self.password = password.encode()
+
+    def request(self, command, payload=b""):
+        """Returns (status, payload) of the reply, or raises socket.timeout.
+
+        A command that needs signing is answered unauthorized with the session
+        number and the last accepted counter, and is then sent again signed.
+        """
+        status, reply = self.send(command, payload)
+        if status == STATUS_UNAUTHORIZED and len(reply) == 8:
+            session, counter = struct.unpack("<II", reply)
+            status, reply = self.send(command, payload, session, counter + 1)
+        return status, reply
+
+    def send(self, command, payload, session=None, counter=None):
+        self.sequence = (self.sequence + 1) & 0xFF
+        packet = b"SK" + bytes([command, self.sequence]) + payload
+        if session is not None:
+            packet += struct.pack("<I", counter)
+            packet += hmac.new(self.password, struct.pack("<I", session) + packet, hashlib.md5).digest()
+        self.sock.sendto(packet, self.address)
+        while True:
+            data, _ = self.sock.recvfrom(64)
+            # Skip late replies to earlier requests
+            if len(data) >= 5 and data[:2] == b"SK" and data[2] == command | 0x80 and data[3] == self.sequence:
+                return data[4], data[5:]
+
+
+def export_log(client):
+    """Reads the records one by one, oldest first, and prints them as CSV."""
+    print(",".join(LOG_FIELDS))
+    index = 0
+    while True:
+        status, reply = client.request(COMMANDS["log"], struct.pack("<I", index))
+        if status != 0:
+            print("%s at record %d, stop the machine and retry" % (STATUS_NAMES.get(status, status), index), file=sys.stderr)
+            return 1
+        if len(reply) < 4 + LOG_RECORD.size:
+            return 0
+        record = reply[4:4 + LOG_RECORD.size]
+        (magic, version, station, sequence, boot, end, _, start, cook_time, distance, speed, strokes, duration,
+         heater_on, latency, crc) = LOG_RECORD.unpack(record)
+        if magic != b"CL" or zlib.crc32(record[:-4]) != crc:
+            print("record %d is damaged, skipped" % index, file=sys.stderr)
+        else:
+            reason = END_REASONS[end] if end < len(END_REASONS) else str(end)
+            print(",".join(str(v) for v in (sequence, boot, station, reason, start, cook_time, distance, speed,
+                                            strokes, duration, heater_on, latency)))
+        index += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--timeout", type=float, default=1.0, help="reply timeout in seconds")
+    parser.add_argument("--password", default="OrangeMakers", help="the firmware's OTA password")
+    parser.add_argument("command", choices=sorted(list(COMMANDS) + ["ping"]))
+    parser.add_argument("args", nargs="*")
+    args = parser.parse_args()
+    client = Client(args.host, args.port, args.timeout, args.password)
+
+    if args.command == "ping":
+        count = int(args.args[0]) if args.args else 100
+        times = []
+        lost = 0
+        for _ in range(count):
+            start = time.perf_counter()
+            try:
+                client.request(COMMANDS["status"])
+            except socket.timeout:
+                lost += 1
+                continue
+            times.append((time.perf_counter() - start) * 1000.0)
+        if not times:
+            print("no replies")
+            return 1
+        times.sort()
+        print("%d round trips, %d lost: median %.2f ms, p99 %.2f ms, max %.2f ms" % (
+            len(times), lost, statistics.median(times), times[min(len(times) - 1, int(len(times) * 0.99))], times[-1]))
+        return 0
+
+    if args.command == "log":
+        return export_log(client)
+
+    payload = b""
+    if args.command == "set":
+        if len(args.args) != 2 or args.args[0] not in SETTINGS:
+            parser.error("set needs one of %s and a value" % ", ".join(SETTINGS))
+        payload = struct.pack("<Bi", SETTINGS[args.args[0]], int(args.args[1]))
+
+    status, reply = client.request(COMMANDS[args.command], payload)
+    print(STATUS_NAMES.get(status, "status %d" % status))
+    if status != 0:
+        return 1
+    if args.command == "status":
+        state, flags, remaining, position = struct.unpack("<BBIi", reply)
+        name = STATE_NAMES[state] if state < len(STATE_NAMES) else str(state)
+        print("state %s, heater %s, remaining %d ms, position %d steps" % (
+            name, "on" if flags & 1 else "off", remaining, position))
+    elif args.command == "settings":
+        cook_time, total_distance, speed = struct.unpack("<Iii", reply)
+        print("cook_time %d ms, total_distance %d um, speed %d steps/s" % (cook_time, total_distance, speed))
+    elif args.command == "set":
+        print("%s is now %d" % (args.args[0], struct.unpack("<i", reply)[0]))
+    elif args.command == "trace":
+        print("%d records on the serial port" % struct.unpack("<i", reply)[0])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include <ESP32Encoder.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "Benchmark.h"
+#include "ButtonHandler.h"
+#include "InputBus.h"
+#include "InputTrace.h"
+#include "LcdLayout.h"
+#include "MatrixDisplay.h"
+#include "RotaryInput.h"
+#include "Settings.h"
+#include "Station.h"
+#include "StationScheduler.h"
+#include "TaskTable.h"
+#include "TimerService.h"
+
+// Replays an exported input trace through the first station's inputs,
+// state machine and stepper on a virtual clock. One loop pass runs every
+// PASS_MICROS of virtual time, so a trace gives the same state timeline on
+// every run; only the host time each pass takes varies.
+//
+// Usage: replay TRACE_FILE [PASS_MICROS]
+
+// Globals the firmware sources expect from main.cpp
+RotaryInput rotary;
+TimerService timerService;
+
+namespace {
+// Same pins as the firmware's first station and rotary switch
+const Station::Pins STATION_PINS = {13, 12, 27, 14, 16, 15, 2};
+const uint8_t ROTARY_SW_PIN = 19;
+
+const unsigned long INPUT_PERIOD = 5;  // Same rate as the firmware's input task, ms
+const unsigned long DEFAULT_PASS_MICROS = 100;
+const unsigned long TAIL_MICROS = 4000000;  // Virtual time run after the last record, long enough to return from the far end
+
+struct Trace {
+    std::vector<uint8_t> pins;
+    std::vector<InputTrace::Record> records;
+    std::vector<uint64_t> offsets;  // Microseconds from the first record
+    unsigned long dropped;
+};
+
+// Reads the first trace in the file, other serial output around it is skipped
+bool readTrace(FILE* file, Trace& trace) {
+    char line[256];
+    bool inTrace = false;
+    trace.dropped = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (!inTrace) {
+            unsigned version;
+            char pins[128];
+            unsigned long records;
+            if (sscanf(line, "# input-trace %u pins %127s records %lu dropped %lu", &version, pins, &records,
+                       &trace.dropped) != 4 || version != InputTrace::FORMAT_VERSION) {
+                continue;
+            }
+            for (char* pin = strtok(pins, ","); pin != NULL; pin = strtok(NULL, ",")) {
+                trace.pins.push_back(atoi(pin));
+            }
+            inTrace = true;
+            continue;
+        }
+        if (strncmp(line, "# end", 5) == 0) {
+            return true;
+        }
+        unsigned long time;
+        unsigned levels;
+        int encoderDelta;
+        if (sscanf(line, "%lu %x %d", &time, &levels, &encoderDelta) != 3) {
+            continue;
+        }
+        InputTrace::Record record = {static_cast<uint32_t>(time), static_cast<uint16_t>(levels),
+                                     static_cast<int16_t>(encoderDelta)};
+        // Differences of the 32-bit micros() values, so a wrap in the session does not matter
+        uint64_t offset = trace.records.empty() ? 0 : trace.offsets.back() + (record.time - trace.records.back().time);
+        trace.records.push_back(record);
+        trace.offsets.push_back(offset);
+    }
+    return inTrace;
+}
+
+void applyRecord(const Trace& trace, const InputTrace::Record& record) {
+    for (size_t i = 0; i < trace.pins.size(); i++) {
+        hostSetPin(trace.pins[i], (record.levels >> i) & 1);
+    }
+    ESP32Encoder::hostTurn(record.encoderDelta);
+}
+
+// Virtual time of the last level change on each pin, for the input latency
+struct EdgeTimes {
+    uint64_t pin[64];
+};
+
+uint8_t eventPin(const InputEvent& event) {
+    return event.source == InputEvent::SOURCE_START ? STATION_PINS.start : ROTARY_SW_PIN;
+}
+
+// What the loop tasks work on, set up in main()
+struct Loop {
+    InputBus* inputBus;
+    Station* station;
+    StationScheduler* scheduler;
+    EdgeTimes edges;
+    uint64_t now;
+    uint32_t worstLatency;  // ms from a button edge to its event
+    uint32_t events;
+};
+Loop passState;
+
+void pollInputs(unsigned long currentTime) {
+    passState.inputBus->poll(currentTime);
+    InputEvent event;
+    while (passState.inputBus->next(event)) {
+        passState.events++;
+        if (event.type == InputEvent::PRESS || event.type == InputEvent::RELEASE) {
+            uint32_t latency = (passState.now - passState.edges.pin[eventPin(event)]) / 1000;
+            passState.worstLatency = std::max(passState.worstLatency, latency);
+        }
+        passState.station->handleEvent(event, currentTime);
+    }
+}
+
+void serviceStations(unsigned long currentTime) {
+    passState.scheduler->service(currentTime);
+}
+
+uint32_t percentile(std::vector<uint32_t>& values, uint32_t percent) {
+    if (values.empty()) return 0;
+    size_t index = (values.size() - 1) * percent / 100;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s TRACE_FILE [PASS_MICROS]\n", argv[0]);
+        return 2;
+    }
+    FILE* file = fopen(argv[1], "r");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+    Trace trace;
+    bool found = readTrace(file, trace);
+    fclose(file);
+    if (!found || trace.records.empty()) {
+        fprintf(stderr, "%s: no input trace found\n", argv[1]);
+        return 2;
+    }
+    unsigned long passMicros = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_PASS_MICROS;
+    if (passMicros == 0) passMicros = DEFAULT_PASS_MICROS;
+
+    // The machine as setup() leaves it, with the first record's levels already on the pins
+    hostUseVirtualClock();
+    applyRecord(trace, trace.records[0]);
+    timerService.begin();
+    MatrixDisplay display(0x27, 16, 2);
+    LcdLayout layout(display);
+    Settings settings(display, rotary);
+    ButtonHandler rotarySwitch(ROTARY_SW_PIN, "Rotary");
+    rotarySwitch.begin();
+    rotary.begin(17, 18);
+
+    Station station(0, STATION_PINS, settings);
+    station.attachUserInterface(&display, &layout, NULL);
+    station.begin(NULL);
+    StationScheduler scheduler(StationScheduler::STEP_LATENESS_BUDGET);
+    scheduler.add(station);
+
+    InputBus inputBus;
+    inputBus.addButton(station.getStartButton(), InputEvent::SOURCE_START, 0, Station::PARK_PRESS_DURATION);
+    inputBus.addButton(rotarySwitch, InputEvent::SOURCE_ROTARY_SWITCH, 0, Station::SETTINGS_PRESS_DURATION);
+    inputBus.setEncoder(rotary, 0);
+
+    // The firmware's input and station tasks, the others do not touch the state machine
+    passState.inputBus = &inputBus;
+    passState.station = &station;
+    passState.scheduler = &scheduler;
+    TaskTable loopTasks;
+    loopTasks.add("inputs", pollInputs, INPUT_PERIOD, TaskTable::PRIORITY_HIGH, 500);
+    loopTasks.add("stations", serviceStations, 0, TaskTable::PRIORITY_HIGH, 1000);
+
+    Benchmark bench(Serial, "replay");
+    std::vector<uint32_t> passNanos;
+    uint32_t stateWorst[PARKING + 1] = {0};
+    uint32_t stateChanges = 0;
+
+    uint64_t start = hostClockMicros();
+    uint64_t end = start + trace.offsets.back() + TAIL_MICROS;
+    size_t next = 1;
+    uint16_t levels = trace.records[0].levels;
+    SystemState state = station.getState();
+    Serial.printf("{\"target\":\"replay\",\"case\":\"state\",\"time_ms\":0,\"state\":\"%s\"}\n", Station::getStateName(state));
+
+    while (hostClockMicros() < end) {
+        uint64_t now = hostClockMicros();
+        while (next < trace.records.size() && start + trace.offsets[next] <= now) {
+            const InputTrace::Record& record = trace.records[next++];
+            for (size_t i = 0; i < trace.pins.size(); i++) {
+                if (((record.levels ^ levels) >> i) & 1) {
+                    passState.edges.pin[trace.pins[i] & 63] = now;
+                }
+            }
+            levels = record.levels;
+            applyRecord(trace, record);
+        }
+
+        // The loop's input and state machine tasks, timed on the host clock
+        passState.now = now;
+        std::chrono::steady_clock::time_point passStart = std::chrono::steady_clock::now();
+        loopTasks.run(millis(), UINT32_MAX);
+        uint32_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - passStart).count();
+        passNanos.push_back(nanos);
+        stateWorst[state] = std::max(stateWorst[state], nanos);
+
+        if (station.getState() != state) {
+            state = station.getState();
+            stateChanges++;
+            Serial.printf("{\"target\":\"replay\",\"case\":\"state\",\"time_ms\":%lu,\"state\":\"%s\"}\n",
+                          static_cast<unsigned long>((now - start) / 1000), Station::getStateName(state));
+        }
+        hostAdvanceClock(passMicros);
+    }
+
+    bench.record("replay_records", "records", trace.records.size());
+    bench.record("replay_records_dropped", "records", trace.dropped);
+    bench.record("replay_passes", "passes", passNanos.size());
+    bench.record("replay_events", "events", passState.events);
+    bench.record("replay_events_dropped", "events", inputBus.getDroppedCount());
+    bench.record("replay_state_changes", "changes", stateChanges);
+    bench.record("replay_input_latency_worst", "ms", passState.worstLatency);
+    bench.record("replay_input_ticks", "ticks", loopTasks.getStats(0).runs);
+    bench.record("replay_pass_median", "ns", percentile(passNanos, 50));
+    bench.record("replay_pass_p99", "ns", percentile(passNanos, 99));
+    bench.record("replay_pass_worst", "ns", percentile(passNanos, 100));
+    for (uint8_t i = 0; i <= PARKING; i++) {
+        if (stateWorst[i] == 0) continue;
+        char name[48];
+        snprintf(name, sizeof(name), "replay_pass_worst_%s", Station::getStateName(i));
+        bench.record(name, "ns", stateWorst[i]);
+    }
+    return 0;
+}
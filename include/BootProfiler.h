@@ -0,0 +1,31 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+// Records a timestamp at the end of each boot phase, so slow initialisation shows up in the report
+class BootProfiler {
+public:
+    static const uint8_t MAX_PHASES = 16;
+
+    BootProfiler();
+    void mark(const char* phase);
+    uint8_t getPhaseCount() const;
+    const char* getPhaseName(uint8_t index) const;
+    unsigned long getPhaseTime(uint8_t index) const;
+    unsigned long getPhaseDuration(uint8_t index) const;
+    unsigned long getTotalTime() const;
+    void report(Print& out) const;
+
+private:
+    struct Phase {
+        const char* name;
+        unsigned long timestamp;  // Microseconds since boot
+    };
+
+    Phase _phases[MAX_PHASES];
+    volatile uint8_t _count;
+    portMUX_TYPE _lock;
+};
+
+#endif // BOOT_PROFILER_H
@@ -0,0 +1,42 @@
+#ifndef CAPTIVE_DNS_H
+#define CAPTIVE_DNS_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+// Captive portal DNS: answers every A query with the access point address.
+// Queries are answered from the lwIP receive callback, so the control loop
+// does no DNS work and nothing runs while no query arrives. The reply header
+// and answer are built once in begin(); a query only copies in its ID and
+// question.
+class CaptiveDns {
+public:
+    static const uint16_t DEFAULT_PORT = 53;
+    static const uint32_t TTL = 60;  // Seconds
+    static const size_t HEADER_SIZE = 12;
+    static const size_t ANSWER_SIZE = 16;
+    static const size_t MAX_NAME_SIZE = 255;
+    static const size_t MAX_RESPONSE_SIZE = HEADER_SIZE + MAX_NAME_SIZE + 4 + ANSWER_SIZE;
+
+    CaptiveDns();
+    bool begin(IPAddress address, uint16_t port = DEFAULT_PORT);
+    void stop();
+    uint32_t getQueryCount() const;
+    uint32_t getDroppedCount() const;
+
+    // Writes the reply into out, which needs room for MAX_RESPONSE_SIZE bytes; 0 to drop the query
+    size_t buildResponse(const uint8_t* query, size_t length, uint8_t* out) const;
+
+private:
+    AsyncUDP _udp;
+    uint8_t _header[HEADER_SIZE];
+    uint8_t _answer[ANSWER_SIZE];
+    volatile uint32_t _queries;
+    volatile uint32_t _dropped;  // Malformed queries and anything but a standard query
+
+    void setAddress(IPAddress address);
+    static void packetWrapper(void* parameter, AsyncUDPPacket& packet);
+    void handlePacket(AsyncUDPPacket& packet);
+};
+
+#endif // CAPTIVE_DNS_H
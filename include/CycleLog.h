@@ -0,0 +1,87 @@
+#ifndef CYCLE_LOG_H
+#define CYCLE_LOG_H
+
+#include <Arduino.h>
+
+// Append-only log of finished cooking cycles on LittleFS. append() only
+// copies the record into a small queue; the records are written in batches
+// by service() while no carriage is moving, since flash writes stall both
+// cores. The log rotates over a fixed number of segment files, each record
+// carries a CRC so a torn write is skipped when reading back.
+//
+// Record, 44 bytes, little-endian:
+//   'C' 'L' version station sequence(4) boot(2) endReason reserved
+//   startTime(4) cookTime(4) totalDistance(4) speed(2) strokes(2)
+//   duration(4) heaterOnTime(4) peakLatency(4) crc32(4)
+class CycleLog {
+public:
+    static const uint8_t RECORD_SIZE = 44;
+    static const uint8_t QUEUE_SIZE = 8;
+    static const uint16_t SEGMENT_RECORDS = 93;  // One 4 KB flash block per segment
+    static const uint8_t MAX_SEGMENTS = 8;
+    static const unsigned long FLUSH_DELAY = 5000;  // ms a record may wait for more to batch with
+
+    enum EndReason {
+        END_DONE = 0,      // Cook time expired
+        END_ABORTED = 1,   // Start button
+        END_REMOTE = 2,    // Remote abort
+        END_ERROR = 3      // Endstop, stall or OTA update
+    };
+
+    struct Record {
+        uint32_t sequence;      // Cycle number since the log was created, set when written
+        uint16_t boot;          // Power-up count since the log was created, set when written
+        uint8_t station;
+        uint8_t endReason;
+        uint32_t startTime;     // millis() at the start of the cycle
+        uint32_t cookTime;      // Setting, in ms
+        uint32_t totalDistance; // Setting, in micrometres
+        uint16_t speed;         // Setting, in steps per second
+        uint16_t strokes;
+        uint32_t duration;      // Actual cook time, in ms
+        uint32_t heaterOnTime;  // ms
+        uint32_t peakLatency;   // Longest gap between two station updates, in microseconds
+    };
+
+    CycleLog();
+    bool begin();
+    bool isReady() const;
+    bool append(const Record& record, unsigned long now);
+    void service(unsigned long now, bool motionActive);
+    bool flush();
+    uint32_t getRecordCount() const;
+    bool readRecord(uint32_t index, uint8_t* out);
+    uint32_t getDroppedCount() const;
+
+    static void encode(const Record& record, uint8_t* out);
+    static bool decode(const uint8_t* data, Record& record);
+
+private:
+    static const uint8_t VERSION = 1;
+    static const uint8_t MAGIC_0 = 'C';
+    static const uint8_t MAGIC_1 = 'L';
+
+    volatile bool _ready;  // Set once begin() has mounted the file system and found the segments
+    Record _queue[QUEUE_SIZE];
+    uint8_t _queueHead;
+    uint8_t _queueCount;
+    unsigned long _oldestQueued;  // millis() when the oldest queued record was appended
+    uint32_t _dropped;            // Records lost to a full queue
+
+    uint32_t _firstSegment;
+    uint32_t _lastSegment;
+    uint16_t _segmentRecords[MAX_SEGMENTS];  // Indexed by segment number % MAX_SEGMENTS
+    bool _segmentSealed;  // The last segment ends in a torn record, start a new one before writing
+    uint32_t _nextSequence;
+    uint16_t _boot;
+
+    void startSegment();
+    static void segmentPath(uint32_t segment, char* path);
+    static uint32_t crc32(const uint8_t* data, size_t length);
+    static void putU16(uint8_t* out, uint16_t value);
+    static void putU32(uint8_t* out, uint32_t value);
+    static uint16_t getU16(const uint8_t* data);
+    static uint32_t getU32(const uint8_t* data);
+};
+
+#endif // CYCLE_LOG_H
@@ -0,0 +1,59 @@
+#ifndef DEADLINE_MONITOR_H
+#define DEADLINE_MONITOR_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Watches the control loop. Each state has a budget for one loop iteration,
+// overruns are counted per state. A guard timer forces the outputs safe when
+// the loop stops checking in, and the task watchdog resets the chip if the
+// stall lasts.
+class DeadlineMonitor {
+public:
+    static const uint8_t MAX_STATES = 8;
+    typedef void (*SafeOutputsFunction)();
+    typedef const char* (*StateNameFunction)(uint8_t state);
+
+    struct Stats {
+        uint32_t budget;                // Microseconds allowed per iteration
+        uint32_t worst;                 // Longest iteration seen, in microseconds
+        uint32_t iterations;
+        uint32_t overruns;
+        unsigned long lastOverrunTime;  // millis() of the last overrun, 0 if none
+    };
+
+    DeadlineMonitor();
+    void setBudget(uint8_t state, uint32_t budget);
+    void begin(SafeOutputsFunction safeOutputs, uint32_t guardTimeout, uint32_t watchdogTimeout);
+    void loopCheckIn(uint8_t state);
+    void checkIn();
+    void discardIteration();
+    bool hasTripped() const;
+    void clearTrip();
+    uint32_t getTripCount() const;
+    const Stats& getStats(uint8_t state) const;
+    uint32_t getTotalOverruns() const;
+    void resetStats();
+    void report(Print& out, StateNameFunction stateName) const;
+
+private:
+    static const uint32_t GUARD_PERIOD = 50000;  // Guard timer period in microseconds
+
+    Stats _stats[MAX_STATES];
+    uint32_t _totalOverruns;
+    uint8_t _iterationState;
+    unsigned long _iterationStart;
+    bool _iterationStarted;
+
+    SafeOutputsFunction _safeOutputs;
+    esp_timer_handle_t _guardTimer;
+    uint32_t _guardTimeout;  // Microseconds without a check-in before the outputs are forced safe
+    bool _watchdogEnabled;
+    volatile unsigned long _lastCheckIn;
+    volatile bool _tripped;
+    volatile uint32_t _tripCount;
+
+    static void guardCallback(void* arg);
+};
+
+#endif // DEADLINE_MONITOR_H
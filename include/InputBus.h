@@ -0,0 +1,75 @@
+#ifndef INPUT_BUS_H
+#define INPUT_BUS_H
+
+#include <Arduino.h>
+#include "ButtonHandler.h"
+#include "RotaryInput.h"
+
+// One button or encoder change, addressed to the station that owns the input
+struct InputEvent {
+    enum Type : uint8_t {
+        PRESS,
+        RELEASE,     // value: ms the button was held
+        LONG_PRESS,  // Once per press, when held for the button's long press time; value: that time
+        ENCODER      // value: whole detents, steps: detents scaled by the turning speed
+    };
+
+    enum Source : uint8_t {
+        SOURCE_START,          // A station's Start button
+        SOURCE_ROTARY_SWITCH,  // The push switch on the encoder
+        SOURCE_ENCODER
+    };
+
+    Type type;
+    Source source;
+    uint8_t station;
+    int32_t value;
+    int32_t steps;
+    unsigned long time;  // millis() when the input layer saw the change
+};
+
+// Turns the buttons and the encoder into a fixed-capacity queue of events.
+// poll() is the only producer, and each event taken off with next() is
+// handled once by whoever took it. Long presses are detected here, so the
+// consumers never time a held button themselves.
+class InputBus {
+public:
+    static const uint8_t CAPACITY = 16;
+    static const uint8_t MAX_BUTTONS = 9;  // Start buttons of 8 stations and the rotary switch
+
+    InputBus();
+    bool addButton(ButtonHandler& button, InputEvent::Source source, uint8_t station, unsigned long longPress);
+    void setEncoder(RotaryInput& rotary, uint8_t station);
+    void poll(unsigned long currentTime);
+    bool next(InputEvent& event);
+    void clear();
+    bool takeActivity();
+    uint8_t getCount() const;
+    uint32_t getDroppedCount() const;
+
+private:
+    struct Button {
+        ButtonHandler* handler;
+        InputEvent::Source source;
+        uint8_t station;
+        unsigned long longPress;  // ms, 0 for none
+        unsigned long pressTime;
+        bool longPressSent;
+    };
+
+    Button _buttons[MAX_BUTTONS];
+    uint8_t _buttonCount;
+    RotaryInput* _rotary;
+    uint8_t _encoderStation;
+    uint32_t _encoderEvents;  // Encoder interrupt count at the last poll
+
+    InputEvent _queue[CAPACITY];
+    uint8_t _head;
+    uint8_t _count;
+    uint32_t _dropped;
+    bool _activity;  // An event, a held button or encoder movement since takeActivity()
+
+    void push(InputEvent::Type type, InputEvent::Source source, uint8_t station, int32_t value, int32_t steps, unsigned long time);
+};
+
+#endif // INPUT_BUS_H
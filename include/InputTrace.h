@@ -0,0 +1,57 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <Arduino.h>
+#include "RotaryInput.h"
+
+// Records the raw input pins and the encoder, as the loop reads them, into a
+// fixed RAM buffer from boot on. A record is only written when a level or the
+// encoder count changed since the previous pass, so a session of normal use
+// fits. The trace is exported over serial as text and replayed on the host
+// (bench/replay) through the same ButtonHandler, encoder and state machine.
+//
+// Export format, one line each:
+//   # input-trace <version> pins <pin>,<pin>,... records <n> dropped <n>
+//   <micros> <levels, hex, bit i for pin i> <encoder counts since the previous record>
+//   # end
+class InputTrace {
+public:
+    static const uint16_t CAPACITY = 1024;  // Records of 8 bytes
+    static const uint8_t MAX_PINS = 16;
+    static const uint8_t FORMAT_VERSION = 1;
+    static const size_t MAX_LINE_LENGTH = 112;  // Header with MAX_PINS two-digit pins included, fits the 128-byte UART FIFO
+
+    struct Record {
+        uint32_t time;         // micros() at the loop pass that saw the change
+        uint16_t levels;
+        int16_t encoderDelta;
+    };
+
+    InputTrace();
+    bool addPin(uint8_t pin);
+    void setEncoder(RotaryInput& rotary);
+    void sample();
+    bool startExport();
+    bool exportTo(Print& out, size_t room);
+    bool isExporting() const;
+    uint16_t getCount() const;
+    uint32_t getDroppedCount() const;
+
+private:
+    uint8_t _pins[MAX_PINS];
+    uint8_t _pinCount;
+    RotaryInput* _rotary;
+    uint32_t _encoderEvents;  // Encoder interrupt count at the last sample
+    int64_t _encoderCount;
+
+    Record _records[CAPACITY];
+    uint16_t _count;
+    uint32_t _dropped;    // Changes seen after the buffer filled
+    uint16_t _lastLevels;
+    bool _started;        // False until the first sample, which is always recorded
+
+    int32_t _exportIndex;  // Next record to write, -1 for the header, -2 when not exporting
+    uint16_t _exportCount; // Records present when the export started
+};
+
+#endif // INPUT_TRACE_H
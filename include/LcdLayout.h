@@ -0,0 +1,58 @@
+#ifndef LCD_LAYOUT_H
+#define LCD_LAYOUT_H
+
+#include <Arduino.h>
+#include "MatrixDisplay.h"
+
+// Screens with fixed text and fields on top of MatrixDisplay. show() draws
+// the fixed text once; after that only a field whose value changed is
+// formatted and written, without String. Progress bars are drawn with
+// custom characters at 5 steps per cell, loaded into CGRAM by begin().
+class LcdLayout {
+public:
+    static const uint8_t MAX_FIELDS = 4;
+    static const uint8_t MAX_FIELD_WIDTH = MatrixDisplay::MAX_COLS;
+    static const uint16_t PROGRESS_FULL = 1000;  // Progress values are per mille
+
+    enum FieldType {
+        FIELD_NUMBER,  // Right-aligned, value scaled by 10^decimals
+        FIELD_BAR      // Left to right, value 0 to PROGRESS_FULL
+    };
+
+    struct Field {
+        FieldType type;
+        uint8_t row;
+        uint8_t col;
+        uint8_t width;
+        uint8_t decimals;
+    };
+
+    struct Screen {
+        const char* row1;  // Fixed text, the fields are drawn over it
+        const char* row2;
+        const Field* fields;
+        uint8_t fieldCount;
+    };
+
+    explicit LcdLayout(MatrixDisplay& display);
+    void begin();
+    void show(const Screen& screen);
+    bool isShowing(const Screen& screen) const;
+    void hide();
+    void invalidate();
+    void set(uint8_t field, int32_t value);
+
+    static uint8_t formatNumber(int32_t value, uint8_t decimals, uint8_t width, char* out);
+    static void formatBar(int32_t value, uint8_t width, char* out);
+
+private:
+    static const uint8_t CELL_STEPS = 5;   // Pixel columns per character
+    static const uint8_t FIRST_GLYPH = 1;  // CGRAM slots 1-5 hold 1-5 lit columns; 0 would end a C string
+
+    MatrixDisplay& _display;
+    const Screen* _screen;
+    int32_t _values[MAX_FIELDS];
+    bool _valid[MAX_FIELDS];  // False until the field is drawn on the current screen
+};
+
+#endif // LCD_LAYOUT_H
@@ -0,0 +1,21 @@
+#ifndef MACHINE_SNAPSHOT_H
+#define MACHINE_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "SeqLock.h"
+#include "Station.h"
+#include "StationScheduler.h"
+
+// The machine as of the end of one loop pass. The loop publishes it through
+// a SeqLock, so tasks on the other core read a consistent copy without
+// locks and without calling into the stations.
+struct MachineSnapshot {
+    uint32_t iteration;        // Loop passes published so far
+    uint32_t time;             // millis() at publication
+    uint8_t stationCount;
+    Station::Status stations[StationScheduler::MAX_STATIONS];
+};
+
+typedef SeqLock<MachineSnapshot> MachineSnapshotLock;
+
+#endif // MACHINE_SNAPSHOT_H
@@ -3,44 +3,73 @@
 
 #include <Arduino.h>
 #include <LiquidCrystal_I2C.h>
-#include <vector>
-#include <queue>
+#include <array>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 
 class MatrixDisplay {
 public:
+    static const uint8_t MAX_COLS = 20;
+    static const uint8_t MAX_ROWS = 4;
+    static const uint32_t UPDATE_TASK_STACK_SIZE = 2048;  // Bytes
+
     MatrixDisplay(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows);
     ~MatrixDisplay();
     void begin();
     void updateDisplay(const String& row1, const String& row2, unsigned long displayDuration = 0);
+    void updateDisplay(const char* row1, const char* row2);
+    void writeField(uint8_t row, uint8_t col, const char* text, uint8_t length);
+    void defineGlyph(uint8_t slot, const uint8_t pattern[8]);
     void startUpdateThread();
     void stopUpdateThread();
+    TaskHandle_t getUpdateTaskHandle() const;
+
+    // Lets the benchmark cases time private hot paths
+    friend class BenchmarkProbe;
 
 private:
+    static const uint8_t MESSAGE_SLOTS = 2;  // The message on screen and one waiting
+
     struct DisplayMessage {
-        String row1;
-        String row2;
+        char row1[MAX_COLS + 1];
+        char row2[MAX_COLS + 1];
         unsigned long endTime;
     };
 
     LiquidCrystal_I2C _lcd;
     uint8_t _cols;
     uint8_t _rows;
-    std::vector<std::vector<char>> _buffer;
+    std::array<char, MAX_ROWS * MAX_COLS> _buffer;  // Row-major, _cols characters per row
+    std::array<char, MAX_ROWS * MAX_COLS> _shown;   // What the LCD holds, valid once written in full
+    bool _shownValid;
     volatile bool _updateNeeded;
     TaskHandle_t _updateTaskHandle;
-    SemaphoreHandle_t _bufferMutex;
+    SemaphoreHandle_t _bufferMutex;   // Only held to change or copy _buffer, never across an LCD transfer
+    SemaphoreHandle_t _lcdMutex;      // Held across LCD transfers
     SemaphoreHandle_t _messageQueueMutex;
-    std::queue<DisplayMessage> _messageQueue;
+    DisplayMessage _messages[MESSAGE_SLOTS];
+    uint8_t _messageHead;
+    uint8_t _messageCount;
     unsigned long _currentMessageEndTime;
 
+    // Backing storage for the update task and mutexes, nothing is allocated at runtime
+    StaticTask_t _updateTaskBuffer;
+    StackType_t _updateTaskStack[UPDATE_TASK_STACK_SIZE];
+    StaticSemaphore_t _bufferMutexBuffer;
+    StaticSemaphore_t _lcdMutexBuffer;
+    StaticSemaphore_t _messageQueueMutexBuffer;
+
     static void updateTaskWrapper(void* parameter);
     void updateTask();
     void updateChangedCharacters();
     void fillBuffer(const String& row1, const String& row2);
+    void fillBuffer(const char* row1, const char* row2);
     void updateBufferWithMessage(const DisplayMessage& message);
+    void setMessage(DisplayMessage& message, const char* row1, const char* row2, unsigned long endTime);
+    void clearMessages();
+    void pushMessage(const DisplayMessage& message);
+    void popMessage();
 };
 
 #endif // MATRIX_DISPLAY_H
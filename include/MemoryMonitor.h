@@ -0,0 +1,38 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Heap and per-task stack usage, to check that the fixed allocations are sized right
+class MemoryMonitor {
+public:
+    static const uint8_t MAX_TASKS = 8;
+
+    MemoryMonitor();
+    void addTask(const char* name, TaskHandle_t handle, uint32_t stackSize);
+    void recordTaskExit();
+    uint8_t getTaskCount() const;
+    const char* getTaskName(uint8_t index) const;
+    uint32_t getStackSize(uint8_t index) const;
+    uint32_t getStackHighWaterMark(uint8_t index) const;
+    uint32_t getFreeHeap() const;
+    uint32_t getMinFreeHeap() const;
+    uint32_t getLargestFreeBlock() const;
+    void report(Print& out) const;
+
+private:
+    struct Task {
+        const char* name;
+        TaskHandle_t handle;       // NULL once the task has exited
+        uint32_t stackSize;        // Bytes
+        uint32_t exitHighWaterMark;  // Bytes never used, kept from when the task exited
+    };
+
+    Task _tasks[MAX_TASKS];
+    volatile uint8_t _count;
+    portMUX_TYPE _lock;
+};
+
+#endif // MEMORY_MONITOR_H
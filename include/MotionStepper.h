@@ -0,0 +1,76 @@
+#ifndef MOTION_STEPPER_H
+#define MOTION_STEPPER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "SCurvePlanner.h"
+#include "Units.h"
+#include "freertos/FreeRTOS.h"
+
+// Step/direction driver with the AccelStepper-style interface used by the state machine.
+// Moves follow jerk-limited profiles from SCurvePlanner instead of trapezoids.
+// Polled, run() makes each step once it is due. Queued, run() plans up to
+// QUEUE_AHEAD of steps into a queue that pulse() empties from a timer
+// interrupt, so the steps keep their times while run() is held up.
+class MotionStepper {
+public:
+    static const uint8_t QUEUE_SIZE = 32;      // Steps, 30 are 8 ms and the step under way at 3500 steps/s
+    static const uint32_t QUEUE_AHEAD = 8000;  // Microseconds of steps run() keeps queued
+
+    MotionStepper(uint8_t stepPin, uint8_t dirPin);
+    void setMaxSpeed(float speed);
+    void setMaxSpeed(StepsPerSecond speed) { setMaxSpeed(speed.value()); }
+    void setAcceleration(float acceleration);
+    void setJerk(float jerk);
+    void moveTo(long absolute);
+    void moveTo(Steps absolute) { moveTo(static_cast<long>(absolute.value())); }
+    void move(long relative);
+    void move(Steps relative) { move(static_cast<long>(relative.value())); }
+    void stop();
+    bool run();
+    void setQueued(bool queued);
+    uint32_t pulse(unsigned long now);
+    long distanceToGo() const;
+    long targetPosition() const;
+    long currentPosition() const;
+    Millimetres currentDistance() const { return Drive::toMillimetres(Steps(_position)); }
+    void setCurrentPosition(long position);
+    float speed() const;
+    float maxSpeed() const;
+    bool isRunning() const;
+    bool isBraking() const;
+    uint32_t getWorstLateness() const;
+    uint32_t getUnderruns() const;
+    void resetLateness();
+
+private:
+    struct QueuedStep {
+        uint32_t interval;  // Microseconds after the previous step
+        int8_t direction;
+        bool restart;       // First step of a move or after an underrun, timed from when pulse() sees it
+    };
+
+    SCurvePlanner _planner;
+    uint8_t _stepPin;
+    uint8_t _dirPin;
+    volatile long _position;
+    int8_t _direction;
+    uint32_t _pendingInterval;
+    int8_t _pendingDirection;
+    volatile unsigned long _lastStepTime;
+    bool _idle;
+    volatile uint32_t _worstLateness;  // Longest delay of a step past its planned time, in microseconds
+
+    bool _queued;
+    bool _planning;                   // The planner handed out steps since it last ran out
+    uint32_t _underruns;              // Times the queue ran empty while the planner still had steps
+    QueuedStep _queue[QUEUE_SIZE];
+    std::atomic<uint8_t> _queueHead;  // Next step for pulse()
+    std::atomic<uint8_t> _queueTail;  // Next free entry for fill()
+    portMUX_TYPE _queueLock;          // Keeps pulse() out while setCurrentPosition() drops the queue
+
+    bool fill();
+    void step(int8_t direction);
+};
+
+#endif // MOTION_STEPPER_H
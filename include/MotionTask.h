@@ -0,0 +1,84 @@
+#ifndef MOTION_TASK_H
+#define MOTION_TASK_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "StationScheduler.h"
+
+// Steps the carriages and runs the safety checks that can not wait for the
+// control loop. A one-shot hardware timer interrupt makes each queued step
+// when it is due and sets its next alarm to the step after that, so the
+// loop's menus, display and network work can not delay a step. Every PERIOD
+// microseconds while a carriage moves, the interrupt also wakes a
+// high-priority task pinned to core 1, which refills the step queues and
+// runs the safety checks. A station the loop holds is refilled on a later
+// wake; its queued steps go on meanwhile. Wake interval jitter is measured
+// against PERIOD.
+class MotionTask {
+public:
+    static const uint32_t PERIOD = 500;         // Microseconds between refills, the queue holds 16 times this
+    static const uint32_t MIN_ALARM = 5;        // Microseconds, the shortest alarm the interrupt sets
+    static const uint32_t STACK_SIZE = 3072;    // Bytes
+    static const UBaseType_t PRIORITY = 20;     // Above the loop (1), below the esp_timer task (22)
+    static const BaseType_t CORE = 1;           // With the loop, away from Wi-Fi on core 0
+    static const uint8_t HARDWARE_TIMER = 0;
+
+    struct Stats {
+        uint32_t ticks;              // Refills
+        uint32_t missedTicks;        // Refill wakes that came while the previous refill still ran
+        uint32_t busyStations;       // Station refills skipped because the loop was updating the station
+        uint32_t worstJitter;        // Largest deviation of a refill interval from PERIOD, in microseconds
+        uint32_t meanJitter;
+        uint32_t worstDuration;      // Longest refill, in microseconds
+        uint32_t interrupts;         // Timer interrupts, one per step or refill wake
+        uint32_t worstInterrupt;     // Longest interrupt, in microseconds
+    };
+
+    MotionTask();
+    bool begin(StationScheduler& scheduler);
+    void setRunning(bool running);
+    bool isRunning() const;
+    TaskHandle_t getTaskHandle() const;
+    void getStats(Stats& stats) const;
+    void resetStats();
+
+private:
+    StationScheduler* _scheduler;
+    hw_timer_t* _timer;
+    TaskHandle_t _task;
+    volatile bool _running;
+    bool _intervalValid;      // False until the first tick after starting
+    unsigned long _lastTick;
+    volatile unsigned long _lastWake;  // When the interrupt last woke the task
+    portMUX_TYPE _timerLock;           // The interrupt and arm() both set the alarm
+
+    volatile uint32_t _ticks;
+    volatile uint32_t _missedTicks;
+    volatile uint32_t _busyStations;
+    volatile uint32_t _worstJitter;
+    volatile uint32_t _worstDuration;
+    volatile uint32_t _intervals;   // Ticks with a previous tick to measure from
+    uint64_t _jitterSum;
+    volatile uint32_t _interrupts;
+    volatile uint32_t _worstInterrupt;
+    volatile bool _resetRequested;  // Stats are cleared by the task itself, between ticks
+
+    StaticTask_t _taskBuffer;
+    StackType_t _taskStack[STACK_SIZE];
+
+    static MotionTask* _instance;  // For the timer interrupt, which takes no argument
+
+    MotionTask(const MotionTask&);
+    MotionTask& operator=(const MotionTask&);
+
+    void run();
+    void tick();
+    void clearStats();
+    void arm(uint32_t delay);
+    void interrupt();
+    static void taskWrapper(void* parameter);
+    static void onTimer();
+};
+
+#endif // MOTION_TASK_H
@@ -0,0 +1,56 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Firmware updates over TCP, raw or deflate compressed. Compressed images
+// are inflated as they arrive, straight into the OTA partition, so only the
+// 32 KB inflate window is held in RAM. poll() runs a whole transfer once a
+// client connects, so only call it with the machine in a safe state.
+//
+// Header, 48 bytes, little-endian:
+//   'S' 'K' 'O' 'T' format reserved(3) imageSize(4) payloadSize(4) md5(16) auth(16)
+// followed by payloadSize bytes. md5 is the digest of the uncompressed image,
+// auth the MD5 of the OTA password followed by md5. The reply is "OK\n" or
+// "ERR <reason>\n".
+class OtaUpdater {
+public:
+    static const uint16_t DEFAULT_PORT = 3233;
+    static const uint8_t HEADER_SIZE = 48;
+    static const unsigned long RECEIVE_TIMEOUT = 10000;  // ms without data before a transfer is given up
+
+    enum Format {
+        FORMAT_RAW = 0,
+        FORMAT_DEFLATE = 1  // zlib stream, as written by zlib.compress()
+    };
+
+    enum Result {
+        RESULT_NONE,    // No client
+        RESULT_OK,      // Image written and verified, restart to run it
+        RESULT_FAILED   // See getError()
+    };
+
+    // Called for every chunk and while waiting for data, so the caller can feed its watchdogs
+    typedef void (*ProgressFunction)(uint32_t written, uint32_t total);
+
+    OtaUpdater();
+    void begin(const char* password, uint16_t port = DEFAULT_PORT);
+    Result poll(ProgressFunction progress);
+    const char* getError() const;
+
+private:
+    static const uint16_t CHUNK_SIZE = 1024;
+
+    WiFiServer _server;
+    bool _started;
+    const char* _password;
+    const char* _error;
+
+    bool receive(WiFiClient& client, ProgressFunction progress);
+    bool readExact(WiFiClient& client, uint8_t* buffer, size_t length, uint32_t written, uint32_t total, ProgressFunction progress);
+    bool fail(const char* error);
+    static uint32_t getU32(const uint8_t* data);
+};
+
+#endif // OTA_UPDATER_H
@@ -0,0 +1,22 @@
+#ifndef POSITION_STORE_H
+#define POSITION_STORE_H
+
+#include <Arduino.h>
+
+// Keeps the last known stepper position in RTC memory so a soft reset or an
+// OTA reboot can verify the home position instead of running a full homing.
+class PositionStore {
+public:
+    PositionStore();
+    void begin();
+    bool hasValidPosition() const;
+    long getPosition() const;
+    void save(long position);
+    void invalidate();
+
+private:
+    bool _valid;
+    long _position;
+};
+
+#endif // POSITION_STORE_H
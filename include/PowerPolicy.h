@@ -0,0 +1,50 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <Arduino.h>
+
+// Decides how much power the machine may save, from the system state and how
+// long it has been since the last input. Each state has a profile. The policy
+// only decides, the caller applies CPU speed, sleep, radio and stepper driver
+// settings, so the same logic runs in the host build.
+class PowerPolicy {
+public:
+    static const uint8_t MAX_STATES = 8;
+    static const uint32_t FULL_CPU_MHZ = 240;
+    static const uint32_t REDUCED_CPU_MHZ = 80;  // Lowest speed that keeps the 80 MHz APB clock for I2C, UART and PCNT
+
+    enum Profile {
+        PROFILE_FULL,     // Never save power, for states that drive the motor or heater
+        PROFILE_REDUCED,  // Lower CPU speed and release the stepper once idle
+        PROFILE_SLEEP     // As PROFILE_REDUCED, plus light sleep while no client is connected
+    };
+
+    PowerPolicy();
+    void setProfile(uint8_t state, Profile profile);
+    void setTimeouts(unsigned long reduceDelay, unsigned long sleepDelay, unsigned long stepperTimeout);
+    void update(uint8_t state, bool inputActive, bool clientConnected, unsigned long now);
+    void recordWake(unsigned long now);
+    uint32_t getCpuMhz() const;
+    bool allowsLightSleep() const;
+    bool isRadioLowPower() const;
+    bool isStepperIdle() const;
+    unsigned long getIdleTime(unsigned long now) const;
+
+private:
+    // Awake time between light sleeps, so the access point still sends beacons
+    static const unsigned long AWAKE_WINDOW = 100;
+
+    Profile _profiles[MAX_STATES];
+    unsigned long _reduceDelay;    // ms without input before the CPU slows down
+    unsigned long _sleepDelay;     // ms without input before light sleep
+    unsigned long _stepperTimeout; // ms without input before the stepper driver is released
+    uint8_t _state;
+    unsigned long _lastActivity;
+    unsigned long _lastWake;
+    uint32_t _cpuMhz;
+    bool _lightSleep;
+    bool _radioLowPower;
+    bool _stepperIdle;
+};
+
+#endif // POWER_POLICY_H
@@ -0,0 +1,107 @@
+#ifndef REMOTE_CONTROL_H
+#define REMOTE_CONTROL_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+// Binary command protocol over UDP on the access point. poll() never blocks:
+// it reads the packets that have already arrived and queues them, and the
+// state machine takes them off the queue and answers each one.
+//
+// Request: 'S' 'K' command sequence [payload]
+// Reply:   'S' 'K' command|0x80 sequence status [payload]
+// Multi-byte values are little-endian.
+//
+// Commands that move a carriage, change a setting or enter OTA mode also end in a counter
+// and an HMAC-MD5 tag, keyed with the OTA password, over the session number
+// and the request before the tag. The session number is drawn at boot and
+// the counter has to grow from one accepted request to the next, so a
+// recorded request can not be played back. Without a valid tag the reply is
+// STATUS_UNAUTHORIZED with the session number and the last accepted counter.
+class RemoteControl {
+public:
+    static const uint16_t DEFAULT_PORT = 4210;
+    static const uint8_t QUEUE_SIZE = 4;
+    static const uint8_t HEADER_SIZE = 4;
+    static const uint8_t MAX_PACKET_SIZE = 64;
+    static const uint8_t TAG_SIZE = 16;             // HMAC-MD5
+    static const uint8_t AUTH_SIZE = 4 + TAG_SIZE;  // Counter and tag
+
+    enum Command {
+        CMD_START = 0x01,
+        CMD_ABORT = 0x02,
+        CMD_PARK = 0x03,
+        CMD_GET_STATUS = 0x04,
+        CMD_GET_SETTINGS = 0x05,
+        CMD_SET_SETTING = 0x06,  // Payload: setting, int32 value
+        CMD_READ_LOG = 0x07,     // Payload: uint32 record index
+        CMD_OTA_MODE = 0x08,
+        CMD_EXPORT_TRACE = 0x09  // Streams the input trace over serial
+    };
+
+    enum Status {
+        STATUS_OK = 0,
+        STATUS_REJECTED = 1,    // Not possible in the current state
+        STATUS_BUSY = 2,        // Command queue full, try again
+        STATUS_BAD_REQUEST = 3,  // Unknown command or wrong payload length
+        STATUS_UNAUTHORIZED = 4  // Missing or wrong tag, or a counter already used
+    };
+
+    enum Setting {
+        SETTING_COOK_TIME = 0,       // Milliseconds
+        SETTING_TOTAL_DISTANCE = 1,  // Micrometres
+        SETTING_SPEED = 2            // Steps per second
+    };
+
+    struct Request {
+        uint8_t command;
+        uint8_t sequence;
+        uint8_t setting;
+        int32_t value;
+        uint32_t address;
+        uint16_t port;
+    };
+
+    RemoteControl();
+    bool begin(const char* password, uint16_t port = DEFAULT_PORT);
+    void poll();
+    bool nextRequest(Request& request);
+    void reply(const Request& request, Status status);
+    void replyValue(const Request& request, Status status, int32_t value);
+    void replyStatus(const Request& request, uint8_t state, bool heaterOn, uint32_t remainingTime, int32_t position);
+    void replySettings(const Request& request, uint32_t cookTime, int32_t totalDistance, int32_t speed);
+    void replyLogRecord(const Request& request, uint32_t recordCount, const uint8_t* record, size_t length);
+    uint32_t getDroppedCount() const;
+    uint32_t getSession() const;
+    size_t sign(uint8_t* packet, size_t length, uint32_t counter) const;
+
+    static bool requiresAuth(uint8_t command);
+    static Status decode(const uint8_t* data, size_t length, Request& request);
+    static size_t encodeReply(const Request& request, Status status, const uint8_t* payload, size_t payloadLength, uint8_t* out);
+
+private:
+    static const uint8_t MAX_PACKETS_PER_POLL = 4;  // Bounds the work of one loop pass
+    static const uint8_t MAGIC_0 = 'S';
+    static const uint8_t MAGIC_1 = 'K';
+    static const uint8_t REPLY_FLAG = 0x80;
+    static const uint8_t HMAC_BLOCK_SIZE = 64;
+
+    WiFiUDP _udp;
+    bool _started;
+    Request _queue[QUEUE_SIZE];
+    uint8_t _queueHead;
+    uint8_t _queueCount;
+    uint32_t _dropped;  // Requests answered BUSY, BAD_REQUEST or UNAUTHORIZED
+    uint32_t _session;
+    uint32_t _counter;  // Of the last accepted signed request
+    uint8_t _innerPad[HMAC_BLOCK_SIZE];  // The HMAC key XOR 0x36
+    uint8_t _outerPad[HMAC_BLOCK_SIZE];  // The HMAC key XOR 0x5c
+
+    bool authenticate(const uint8_t* data, size_t length);
+    void tag(const uint8_t* message, size_t length, uint8_t* out) const;
+    void send(const Request& request, Status status, const uint8_t* payload, size_t payloadLength);
+    static void putU32(uint8_t* out, uint32_t value);
+    static uint32_t getU32(const uint8_t* data);
+};
+
+#endif // REMOTE_CONTROL_H
@@ -0,0 +1,39 @@
+#ifndef ROTARY_INPUT_H
+#define ROTARY_INPUT_H
+
+#include <Arduino.h>
+#include <ESP32Encoder.h>
+
+// Rotary encoder on a PCNT unit. The encoder interrupt only bumps an event
+// counter, so polls without movement never touch the counter hardware.
+// Counts are accumulated into whole detents, and fast turns are scaled up.
+class RotaryInput {
+public:
+    static const int32_t COUNTS_PER_DETENT = 2;  // Half quadrature, two edges per detent
+
+    RotaryInput();
+    void begin(uint8_t clkPin, uint8_t dtPin);
+    int32_t readDetents();
+    int32_t readSteps();
+    int32_t accelerate(int32_t detents);
+    int64_t getCount();
+    uint32_t getEventCount() const;
+    void reset();
+
+private:
+    // Turning speeds in detents per second where the multipliers kick in
+    static const uint32_t MEDIUM_RATE = 8;
+    static const uint32_t FAST_RATE = 20;
+    static const int32_t MEDIUM_MULTIPLIER = 4;
+    static const int32_t FAST_MULTIPLIER = 10;
+
+    ESP32Encoder _encoder;
+    volatile uint32_t _events;
+    uint32_t _seenEvents;
+    int64_t _consumedCount;
+    unsigned long _lastDetentTime;
+
+    static void IRAM_ATTR onEncoderEvent(void* arg);
+};
+
+#endif // ROTARY_INPUT_H
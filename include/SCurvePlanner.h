@@ -0,0 +1,48 @@
+#ifndef SCURVE_PLANNER_H
+#define SCURVE_PLANNER_H
+
+#include <stdint.h>
+
+// Jerk-limited (S-curve) step planner using fixed-point math.
+// Each call to nextStep() plans one step and returns the interval in microseconds
+// to wait before it, so a polled or timer-driven pulse generator can consume it.
+// The target may change at any time, the velocity profile stays continuous.
+class SCurvePlanner {
+public:
+    SCurvePlanner();
+    void setMaxSpeed(uint32_t speed);
+    void setAcceleration(uint32_t acceleration);
+    void setJerk(uint32_t jerk);
+    void setStartSpeed(uint32_t speed);
+    void setPosition(int32_t position);
+    void setTarget(int32_t target);
+    void stop();
+    uint32_t nextStep(int8_t& direction);
+
+    int32_t getPosition() const;
+    int32_t getTarget() const;
+    int32_t getSpeed() const;
+    uint32_t getMaxSpeed() const;
+    uint32_t getStoppingDistance() const;
+    bool isMoving() const;
+    bool isBraking() const;
+
+private:
+    static const uint8_t FRACTION_BITS = 8;  // Speed and acceleration are Q8 fixed point
+    static const uint32_t MICROS_PER_SECOND = 1000000;
+
+    uint32_t _maxSpeed;       // steps/s, Q8
+    uint32_t _acceleration;   // steps/s^2, Q8
+    uint32_t _jerk;           // steps/s^3
+    uint32_t _startSpeed;     // steps/s, Q8
+
+    int32_t _position;
+    int32_t _target;
+    int8_t _frame;            // +1 or -1, the side of the target that velocity and acceleration refer to
+    int32_t _velocity;        // Towards the target, Q8
+    int32_t _accel;           // Towards the target, Q8
+    bool _braking;
+    bool _moving;
+};
+
+#endif // SCURVE_PLANNER_H
@@ -0,0 +1,57 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Single-writer sequence lock around a plain struct. The writer never waits;
+// readers on any core copy the value and retry if a write overlapped the
+// copy, so they never see a torn value and never block the writer. The
+// sequence is odd while a write is in progress.
+template <typename T>
+class SeqLock {
+public:
+    static const uint8_t MAX_READ_ATTEMPTS = 8;
+
+    SeqLock() : _sequence(0), _value() {}
+
+    // Only ever called from one task
+    void write(const T& value) {
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _value = value;
+        std::atomic_thread_fence(std::memory_order_release);
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // False if every attempt overlapped a write, which only happens when the
+    // reader preempted the writer on its own core; out is then unchanged
+    bool read(T& out) const {
+        for (uint8_t attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+            uint32_t before = _sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            T copy = _value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_sequence.load(std::memory_order_relaxed) == before) {
+                out = copy;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Completed writes so far
+    uint32_t getVersion() const {
+        return _sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    std::atomic<uint32_t> _sequence;
+    T _value;
+
+    SeqLock(const SeqLock&);
+    SeqLock& operator=(const SeqLock&);
+};
+
+#endif // SEQ_LOCK_H
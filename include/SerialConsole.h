@@ -0,0 +1,55 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+
+// Line-based command console on a serial port, for inspecting a running
+// machine without a debug build. poll() reads what has arrived without
+// waiting and runs at most one complete line per call. Commands print into
+// a fixed output buffer, which drain() hands to the port only as fast as
+// its transmit buffer has room; output that does not fit is dropped and
+// counted rather than waited for.
+class SerialConsole : public Print {
+public:
+    static const uint8_t MAX_COMMANDS = 16;
+    static const size_t MAX_LINE_LENGTH = 48;       // Longest command line, longer ones are rejected
+    static const size_t OUTPUT_BUFFER_SIZE = 2048;  // Bytes, room for the longest report
+    typedef void (*CommandFunction)(Print& out, const char* args, unsigned long currentTime);
+
+    SerialConsole();
+    bool addCommand(const char* name, const char* help, CommandFunction function);
+    void begin(Stream& stream);
+    void poll(unsigned long currentTime);
+    void drain(size_t room);
+    bool hasOutput() const;
+    uint32_t getDroppedBytes() const;
+    void printHelp(Print& out) const;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+private:
+    struct Command {
+        const char* name;
+        const char* help;
+        CommandFunction function;
+    };
+
+    Command _commands[MAX_COMMANDS];
+    uint8_t _commandCount;
+    Stream* _stream;
+
+    char _line[MAX_LINE_LENGTH + 1];
+    uint8_t _lineLength;
+    bool _lineTooLong;  // Discarding until the end of an overlong line
+
+    uint8_t _output[OUTPUT_BUFFER_SIZE];
+    size_t _outputHead;   // Next byte to send
+    size_t _outputCount;
+    uint32_t _droppedBytes;
+
+    void execute(unsigned long currentTime);
+};
+
+#endif // SERIAL_CONSOLE_H
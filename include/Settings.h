@@ -2,84 +2,123 @@
 #define SETTINGS_H
 
 #include <Arduino.h>
-#include <ESP32Encoder.h>
-#include <vector>
-#include "ButtonHandler.h"
+#include "InputBus.h"
 #include "MatrixDisplay.h"
-
-extern ButtonHandler buttonRotarySwitch;
+#include "RotaryInput.h"
+#include "SettingsSchema.h"
+#include "Units.h"
 
 class Settings {
 public:
-    Settings(MatrixDisplay& display, ESP32Encoder& encoder);
+    Settings(MatrixDisplay& display, RotaryInput& rotary);
     void loadSettingsFromPreferences();
     void saveSettingsToPreferences();
-    unsigned long getCookTime() const;
-    float getTotalDistance() const;
-    float getSpeed() const;
-    int getTotalSteps() const;
-    static constexpr float DISTANCE_PER_REV = 8.0f;
-    static constexpr int STEPS_PER_REV = 1600;
+    Millis getCookTime() const;
+    Millimetres getTotalDistance() const;
+    StepsPerSecond getSpeed() const;
+    Steps getTotalSteps() const;
+    void setCookTime(Millis cookTime);
+    void setTotalDistance(Millimetres totalDistance);
+    void setSpeed(StepsPerSecond speed);
     ~Settings();
 
     void enter();
     void exit();
+    void handleEvent(const InputEvent& event);
     void update();
     bool isDone() const;
 
+    // Lets the benchmark cases time private hot paths
+    friend class BenchmarkProbe;
+
 private:
-    int _totalSteps;
+    Steps _totalSteps;
     MatrixDisplay& _display;
-    enum class MenuItem {
-        COOK_TIME,
-        TOTAL_DISTANCE,
-        MAX_SPEED,
+
+    // Menu entries after the settings of the schema
+    enum class Action {
         LOAD_EEPROM,
         SAVE_EEPROM,
         EXIT,
         FACTORY_RESET
     };
 
-    struct MenuItemInfo {
-        MenuItem item;
+    struct ActionInfo {
+        Action action;
         const char* displayName;
-        bool visible;
+        bool alwaysVisible;  // Storage actions only show up once a value differs from the stored one
+    };
+
+    static const size_t ACTION_COUNT = 4;
+    static constexpr ActionInfo ACTIONS[ACTION_COUNT] = {
+        {Action::LOAD_EEPROM, "Load EEPROM", false},
+        {Action::SAVE_EEPROM, "Save EEPROM", false},
+        {Action::EXIT, "Exit", true},
+        {Action::FACTORY_RESET, "Factory Reset", false}
     };
 
-    ESP32Encoder& _encoder;
+    // The schema's settings first, then the actions
+    static const size_t MENU_ITEM_COUNT = SettingsSchema::COUNT + ACTION_COUNT;
+
+    // Formatted value of a setting, redone only when the value changes
+    struct ValueText {
+        long key;
+        char text[16];
+    };
+
+    RotaryInput& _rotary;
     bool _isDone;
     bool _inEditMode;
-    std::vector<MenuItemInfo> _menuItems;
+    bool _confirming;       // A Yes/No question is shown for _confirmAction
+    bool _confirmed;
+    Action _confirmAction;
+    const char* _confirmMessage;
     size_t _currentMenuIndex;
-    int32_t _lastEncoderValue;
+
+    // A result message shown for a while, then the menu again or the menu is left
+    static const unsigned long LOADED_MESSAGE_DURATION = 1000;  // ms
+    static const unsigned long SAVED_MESSAGE_DURATION = 1000;   // ms
+    static const unsigned long RESET_MESSAGE_DURATION = 2000;   // ms
+    bool _showingMessage;
+    bool _exitAfterMessage;
+    unsigned long _messageStart;
+    unsigned long _messageDuration;
 
     bool _settingsChanged;
-    unsigned long _initialCookTime;
-    float _initialTotalDistance;
-    float _initialSpeed;
+    float _values[SettingsSchema::COUNT];
+    float _storedValues[SettingsSchema::COUNT];  // As last loaded or saved
 
-    void initializeMenuItems();
+    void setValue(size_t id, float value);
+    void markStored();
     void updateMenuVisibility();
+    bool isVisible(size_t menuIndex) const;
+    const char* menuName(size_t menuIndex) const;
     void displayCurrentMenuItem();
-    int8_t getEncoderDirection();
-    void handleMenuNavigation(int8_t direction);
+    void handleMenuNavigation(int32_t detents);
     void handleMenuSelection();
+    void handleAction(Action action);
     void enterEditMode();
     void exitEditMode();
-    void adjustValue(int8_t direction);
-    void adjustCookTime(int8_t direction);
-    void adjustTotalDistance(int8_t direction);
-    void adjustMaxSpeed(int8_t direction);
-    void updateDisplay();
+    void adjustValue(int32_t steps);
+    long valueKey(size_t id) const;
+    const char* valueText(size_t id);
+    void requestRender();
+    void invalidateRender();
+    void flushRender();
     void factoryReset();
-    bool confirmAction(const char* message);
-
-    unsigned long _cookTime;
-    float _totalDistance;
-    float _speed;
+    void startConfirm(Action action, const char* message);
+    void handleConfirmEvent(const InputEvent& event);
+    void finishConfirm();
+    void showMessage(const char* row1, const char* row2, unsigned long duration, bool exitAfter);
+    void returnToMenu();
 
-    static constexpr float SPEED_MIN = 500.0f;
-    static constexpr float SPEED_MAX = 3500.0f;
+    // Rendering, coalesced to at most one display update per RENDER_INTERVAL
+    static const unsigned long RENDER_INTERVAL = 40;  // ms
+    ValueText _valueTexts[SettingsSchema::COUNT];
+    bool _renderPending;
+    unsigned long _lastRenderTime;
+    size_t _renderedIndex;
+    long _renderedKey;
 };
 
 #endif // SETTINGS_H
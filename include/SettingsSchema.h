@@ -0,0 +1,76 @@
+#ifndef SETTINGS_SCHEMA_H
+#define SETTINGS_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One user setting: its menu entry, limits, encoder step, NVS key and
+// factory default. Values are held as float; cook time in ms stays exact.
+struct SettingField {
+    enum Storage : uint8_t {
+        STORE_ULONG,  // Preferences::putULong(), rounded
+        STORE_FLOAT
+    };
+
+    enum Format : uint8_t {
+        FORMAT_THOUSANDTHS,  // Whole thousandths of the value, "30s" for 30000 ms
+        FORMAT_TENTHS,       // One decimal, "50.0mm"
+        FORMAT_PERCENT       // Position within min..max, "50%"
+    };
+
+    const char* key;   // NVS key in the "settings" namespace
+    const char* name;  // Menu label, at most 16 characters
+    const char* unit;  // Appended to the formatted value
+    float min;
+    float max;
+    float step;        // Change per encoder step in edit mode
+    float defaultValue;
+    Storage storage;
+    Format format;
+
+    constexpr float clamp(float value) const {
+        return value < min ? min : (value > max ? max : value);
+    }
+
+    constexpr bool contains(float value) const {
+        return value >= min && value <= max;
+    }
+};
+
+// The settings table. The menu, the clamping of edits and remote writes,
+// loading, saving and factory reset all loop over it, so a new setting is
+// a row here, an Id and a getter in Settings.
+namespace SettingsSchema {
+
+enum Id : uint8_t {
+    COOK_TIME,
+    TOTAL_DISTANCE,
+    MAX_SPEED,
+    COUNT
+};
+
+constexpr float SPEED_MIN = 500.0f;   // Steps per second
+constexpr float SPEED_MAX = 3500.0f;  // Validated on the machine, raise only with step-loss measurements
+
+// The NVS keys and types are the ones used before the table, so stored settings survive an update
+constexpr SettingField FIELDS[COUNT] = {
+    {"cookTime", "Cook Time", "s", 5000.0f, 120000.0f, 1000.0f, 30000.0f,
+     SettingField::STORE_ULONG, SettingField::FORMAT_THOUSANDTHS},
+    {"totalDistance", "Total Distance", "mm", 50.0f, 120.0f, 5.0f, 50.0f,
+     SettingField::STORE_FLOAT, SettingField::FORMAT_TENTHS},
+    {"speed", "Max Speed", "%", SPEED_MIN, SPEED_MAX, (SPEED_MAX - SPEED_MIN) / 100.0f, 2000.0f,
+     SettingField::STORE_FLOAT, SettingField::FORMAT_PERCENT}
+};
+
+// Checked once here instead of on every load
+constexpr bool isValid(size_t index) {
+    return index == COUNT ||
+           (FIELDS[index].min < FIELDS[index].max && FIELDS[index].step > 0.0f &&
+            FIELDS[index].contains(FIELDS[index].defaultValue) && isValid(index + 1));
+}
+
+static_assert(isValid(0), "Every setting needs min < max, a positive step and a default within its range");
+
+}  // namespace SettingsSchema
+
+#endif // SETTINGS_SCHEMA_H
@@ -0,0 +1,205 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include <Arduino.h>
+#include "ButtonHandler.h"
+#include "CycleLog.h"
+#include "InputBus.h"
+#include "LcdLayout.h"
+#include "MatrixDisplay.h"
+#include "MotionStepper.h"
+#include "PositionStore.h"
+#include "Settings.h"
+#include "StrokeMotion.h"
+#include "Timer.h"
+#include "TimerService.h"
+#include "Units.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Define system states
+enum SystemState {
+    STARTUP,
+    HOMING,
+    IDLE,
+    RUNNING,
+    RETURNING_TO_START,
+    ERROR,
+    SETTINGS_MENU,
+    PARKING
+};
+
+// One cooking station: stepper, heater relay, endstop, start button, timer
+// and the state machine that drives them. Stations share the settings. Only
+// the station given the user interface draws on the display, takes the
+// rotary switch and encoder events and owns the stored position. The stepper poll and the
+// safety checks in serviceMotion() may run in a MotionTask; a lock keeps
+// them out while the control loop changes the station. With queued stepping,
+// pulse() makes the steps from the MotionTask's timer interrupt without the
+// lock, and the polls only plan them ahead.
+class Station {
+public:
+    static const uint8_t NO_PIN = 0xFF;
+    static const unsigned long PARK_PRESS_DURATION = 5000;     // ms holding Start in IDLE to park
+    static const unsigned long SETTINGS_PRESS_DURATION = 1000; // ms holding the rotary switch in IDLE for the menu
+    static const uint32_t ENDSTOP_TRIP_TIME = 1000;  // Microseconds the endstop reads triggered before serviceMotion() stops the carriage
+
+    struct Pins {
+        uint8_t step;
+        uint8_t dir;
+        uint8_t enable;     // Stepper driver ENABLE, low enables
+        uint8_t relay;      // Heater relay
+        uint8_t endstop;    // Homing switch
+        uint8_t start;      // Start button
+        uint8_t heaterLed;  // Lit while the heater is on, NO_PIN for none
+    };
+
+    enum Indicator {
+        INDICATOR_HOMING,
+        INDICATOR_IDLE,
+        INDICATOR_RUNNING,
+        INDICATOR_RETURNING
+    };
+    // What other tasks may know about a station, see MachineSnapshot
+    struct Status {
+        uint8_t state;          // SystemState
+        bool heaterOn;
+        bool moving;
+        int32_t position;       // Steps
+        int32_t target;         // Steps
+        uint32_t remainingTime; // Cook time left in ms, 0 when not cooking
+        const char* error;      // Last fail() message, a string literal; "" if none
+    };
+
+    typedef void (*IndicatorFunction)(uint8_t station, Indicator indicator);
+    typedef void (*CycleFunction)(const CycleLog::Record& record);
+
+    Station(uint8_t index, const Pins& pins, Settings& settings);
+    ~Station();
+    void begin(IndicatorFunction indicator, CycleFunction cycleDone = NULL);
+    void attachUserInterface(MatrixDisplay* display, LcdLayout* layout, PositionStore* positionStore);
+    void handleEvent(const InputEvent& event, unsigned long currentTime);
+    void update(unsigned long currentTime);
+    bool serviceMotion();
+    uint32_t pulse(unsigned long now);
+    void setQueuedStepping(bool queued);
+
+    bool start();
+    bool abort(unsigned long currentTime);
+    bool park();
+    void fail(const char* message, unsigned long currentTime);
+    void forceSafeOutputs();
+    void releaseDriver(bool release);
+
+    uint8_t getIndex() const;
+    SystemState getState() const;
+    bool isParked() const;
+    bool isMoving() const;
+    bool isHeaterOn() const;
+    ButtonHandler& getStartButton();
+    unsigned long getRemainingTime() const;
+    long getPosition() const;
+    const char* getErrorMessage() const;
+    void getStatus(Status& status) const;
+    uint32_t getStepLateness() const;
+    uint32_t getStepUnderruns() const;
+    void resetStepLateness();
+
+    static const char* getStateName(uint8_t state);
+
+    // Lets the benchmark cases time the state handlers
+    friend class BenchmarkProbe;
+
+private:
+    // Define homing phases
+    enum HomingPhase {
+        HOMING_WAIT_CONFIRM,
+        HOMING_FAST_APPROACH,
+        HOMING_BACKOFF,
+        HOMING_SLOW_APPROACH,
+        HOMING_MOVE_TO_ZERO
+    };
+
+    uint8_t _index;
+    Pins _pins;
+    Settings& _settings;
+    MatrixDisplay* _display;
+    LcdLayout* _layout;
+    PositionStore* _positionStore;
+    IndicatorFunction _indicator;
+    CycleFunction _cycleDone;
+
+    MotionStepper _stepper;
+    StrokeMotion _strokeMotion;  // Drives _stepper, declared after it
+    Timer _timer;                          // Cook time, turns the heater off on expiry
+    TimerService::TimerId _stateTimer;     // Welcome screen and homing timeout
+    TimerService::TimerId _refreshTimer;   // Periodic display refresh
+    volatile bool _stateTimerExpired;
+    volatile bool _refreshDue;
+    ButtonHandler _startButton;
+    ButtonHandler _endstop;
+
+    volatile SystemState _state;
+    SystemState _previousState;
+    bool _stateJustChanged;
+    const char* _errorMessage;
+
+    HomingPhase _homingPhase;
+    bool _verifyingPosition;
+    bool _homed;                    // The step count matches the carriage, cleared when the driver is released
+    SystemState _stateAfterHoming;  // IDLE, or the start or park that found the station not homed
+    bool _startArmed;  // Start pressed in IDLE, so its release or long press belongs to IDLE
+    bool _heaterOn;
+    bool _driverReleased;
+    bool _parked;
+
+    SemaphoreHandle_t _lock;  // Recursive, held by the control loop while it changes the station
+    StaticSemaphore_t _lockBuffer;
+    volatile bool _endstopTripped;  // Set by serviceMotion(), update() then fails the station
+    bool _endstopHigh;
+    unsigned long _endstopHighSince;
+
+    CycleLog::Record _cycle;  // The cook in progress, handed to _cycleDone when it ends
+    bool _cycleActive;
+    unsigned long _heaterOnSince;
+    unsigned long _lastUpdateMicros;
+
+    Station(const Station&);
+    Station& operator=(const Station&);
+
+    void lock();
+    void unlock();
+    void checkSafety();
+    void changeState(SystemState newState);
+    void startStateTimer(unsigned long duration);
+    void startRefresh();
+    bool refreshDue();
+    void showField(const LcdLayout::Screen& screen, uint8_t field, int32_t value);
+    void handleStartup();
+    void confirmHoming();
+    void startFastApproach();
+    void startAfterHoming(SystemState state);
+    void handleHoming(unsigned long currentTime);
+    void handleIdle();
+    void handleRunning(unsigned long currentTime);
+    void endCooking(CycleLog::EndReason reason, unsigned long currentTime);
+    void handleReturningToStart();
+    void handleError();
+    void handleSettingsMenu();
+    void handleParking();
+
+    void startCycle(unsigned long currentTime);
+    void finishCycle(CycleLog::EndReason reason, unsigned long currentTime);
+    static void cookTimeUp(void* arg);
+    static void stateTimeUp(void* arg);
+    static void refreshTick(void* arg);
+    void startHeater();
+    void stopHeater();
+    void show(const char* row1, const char* row2);
+    void show(const String& row1, const String& row2, unsigned long duration = 0);
+    void indicate(Indicator indicator);
+    void savePosition(long position);
+    void invalidatePosition();
+};
+
+#endif // STATION_H
@@ -0,0 +1,45 @@
+#ifndef STATION_SCHEDULER_H
+#define STATION_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Station.h"
+
+// Runs several stations from the one control loop. Every pass updates each
+// station once, and between two updates every station gets a stepper poll,
+// so one station's slow state handler only delays the others by a single
+// update. The first station to update rotates from pass to pass. Pass time
+// and step lateness are tracked against a budget. Once a MotionTask drives
+// the steppers, they queue their steps and the passes only update the stations.
+class StationScheduler {
+public:
+    static const uint8_t MAX_STATIONS = 8;
+    static const uint32_t STEP_LATENESS_BUDGET = 50;  // Microseconds, under a fifth of the step interval at SPEED_MAX
+
+    explicit StationScheduler(uint32_t stepBudget);
+    bool add(Station& station);
+    void service(unsigned long currentTime);
+    uint8_t serviceMotion();
+    uint32_t pulse(unsigned long now);
+    void setMotionPolling(bool enabled);
+
+    uint8_t getCount() const;
+    Station& getStation(uint8_t index);
+    uint32_t getWorstPass() const;
+    uint32_t getPasses() const;
+    uint32_t getOverBudgetPasses() const;
+    uint32_t getWorstStepLateness() const;
+    uint32_t getStepUnderruns() const;
+    void resetStats();
+
+private:
+    Station* _stations[MAX_STATIONS];
+    uint8_t _count;
+    uint8_t _first;          // Station that updates first in the next pass
+    bool _motionPolling;     // Poll the steppers between updates
+    uint32_t _stepBudget;    // Microseconds a step may be late before a pass counts as over budget
+    uint32_t _worstPass;     // Longest pass, in microseconds
+    uint32_t _passes;
+    uint32_t _overBudgetPasses;
+};
+
+#endif // STATION_SCHEDULER_H
@@ -0,0 +1,40 @@
+#ifndef STROKE_MOTION_H
+#define STROKE_MOTION_H
+
+#include <Arduino.h>
+#include "MotionStepper.h"
+#include "Units.h"
+
+// Reciprocating motion between two positions. Without a dwell time the next
+// stroke is targeted as soon as braking starts, so the planner runs the
+// reversal as one jerk-limited velocity profile through zero.
+class StrokeMotion {
+public:
+    StrokeMotion(MotionStepper& stepper);
+    void configure(Steps startPosition, Steps endPosition, StepsPerSecond maxSpeed, float acceleration, float jerk, Millis dwellTime = Millis(0));
+    void start();
+    void stop();
+    void halt();
+    void update();
+    bool isRunning() const;
+    unsigned long getStrokeCount() const;
+
+private:
+    MotionStepper& _stepper;
+    long _ends[2];
+    uint8_t _targetEnd;
+    float _maxSpeed;
+    float _acceleration;
+    float _jerk;
+    unsigned long _dwellTime;
+
+    bool _running;
+    bool _stopping;
+    bool _dwelling;
+    unsigned long _dwellStartTime;
+    unsigned long _strokeCount;
+
+    void nextStroke();
+};
+
+#endif // STROKE_MOTION_H
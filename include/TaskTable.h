@@ -0,0 +1,62 @@
+#ifndef TASK_TABLE_H
+#define TASK_TABLE_H
+
+#include <Arduino.h>
+
+// Cooperative rate scheduler for the control loop. Each subsystem adds a tick
+// with a period, a priority and a time budget; a pass runs the ticks that are
+// due in the order they were added, which is the order data flows through the
+// loop. A period of 0 runs on every pass. Once a pass has used up its budget,
+// due ticks below PRIORITY_HIGH wait for a later pass, but never by more than
+// their own period. Runs, overruns of the tick budget and deferrals are
+// counted per tick.
+class TaskTable {
+public:
+    static const uint8_t MAX_TASKS = 12;
+    typedef void (*TickFunction)(unsigned long currentTime);
+
+    enum Priority {
+        PRIORITY_LOW,     // Waits once half the pass budget is used
+        PRIORITY_NORMAL,  // Waits once the pass budget is used
+        PRIORITY_HIGH     // Runs whenever it is due
+    };
+
+    struct Stats {
+        const char* name;
+        unsigned long period;  // Milliseconds, 0 for every pass
+        Priority priority;
+        uint32_t budget;       // Microseconds allowed per tick
+        uint32_t worst;        // Longest tick seen, in microseconds
+        uint32_t runs;
+        uint32_t overruns;     // Ticks longer than the budget
+        uint32_t deferrals;    // Passes the tick was due but waited
+    };
+
+    TaskTable();
+    bool add(const char* name, TickFunction tick, unsigned long period, Priority priority, uint32_t budget);
+    void run(unsigned long currentTime, uint32_t passBudget);
+
+    uint8_t getCount() const;
+    const Stats& getStats(uint8_t index) const;
+    uint32_t getPasses() const;
+    uint32_t getTotalOverruns() const;
+    void resetStats();
+    void report(Print& out) const;
+
+private:
+    struct Task {
+        TickFunction tick;
+        unsigned long nextRun;  // millis() the tick is due at
+        bool started;           // False until the first run, which happens on the first pass
+    };
+
+    Task _tasks[MAX_TASKS];
+    Stats _stats[MAX_TASKS];
+    uint8_t _count;
+    uint32_t _passes;
+    uint32_t _totalOverruns;
+
+    bool mayRun(uint8_t index, unsigned long currentTime, uint32_t passTime, uint32_t passBudget) const;
+};
+
+#endif // TASK_TABLE_H
@@ -2,20 +2,40 @@
 #define TIMER_H
 
 #include <Arduino.h>
+#include "TimerService.h"
+#include "Units.h"
 
+// Countdown on a TimerService one-shot. Expiry sets a flag and calls the
+// optional callback from the timer task, at the exact time rather than on
+// the next loop pass. Can be paused and resumed.
 class Timer {
 public:
+    typedef TimerService::Callback Callback;
+
     Timer();
-    void start(unsigned long duration);
+    ~Timer();
+    void onExpiry(Callback callback, void* arg);
+    void start(Millis duration);
     void stop();
+    void pause();
+    void resume();
     bool isRunning() const;
+    bool isPaused() const;
     bool hasExpired() const;
     unsigned long getRemainingTime() const;
+    uint64_t getRemainingMicros() const;
 
 private:
-    unsigned long startTime;
-    unsigned long duration;
-    bool running;
+    TimerService::TimerId _id;  // Taken on first start
+    Callback _callback;
+    void* _arg;
+    bool _running;
+    volatile bool _expired;
+
+    Timer(const Timer&);
+    Timer& operator=(const Timer&);
+
+    static void expiryCallback(void* arg);
 };
 
 #endif // TIMER_H
@@ -0,0 +1,75 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// One-shot and periodic callbacks with microsecond resolution. Pending
+// expiries are kept in a min-heap over a fixed pool of timers, and a single
+// esp_timer is armed for the earliest one, so nothing runs between expiries.
+// Callbacks run in the esp_timer task: keep them short, and only write pins
+// or set flags the loop picks up.
+class TimerService {
+public:
+    static const uint8_t MAX_TIMERS = 32;
+    static const uint8_t NO_TIMER = 0xFF;
+    typedef uint8_t TimerId;
+    typedef void (*Callback)(void* arg);
+
+    TimerService();
+    bool begin();
+    TimerId create(Callback callback, void* arg);
+    void release(TimerId id);
+
+    // Times in microseconds; starting a started timer restarts it
+    void startOnce(TimerId id, uint64_t delay);
+    void startPeriodic(TimerId id, uint64_t period);
+    void stop(TimerId id);
+    void pause(TimerId id);
+    void resume(TimerId id);
+    bool isPending(TimerId id) const;
+    bool isPaused(TimerId id) const;
+    uint64_t getRemaining(TimerId id) const;
+    uint8_t getTimerCount() const;
+
+    static uint64_t now();
+
+private:
+    struct Entry {
+        Callback callback;  // NULL while the slot is free
+        void* arg;
+        uint64_t expiry;    // now() of the next call
+        uint64_t period;    // 0 for one-shot
+        uint64_t remaining; // Left when paused
+        uint8_t heapIndex;  // NO_TIMER when not pending
+        bool paused;
+    };
+
+    Entry _entries[MAX_TIMERS];
+    uint8_t _heap[MAX_TIMERS];  // Pending timers, earliest expiry first
+    uint8_t _heapCount;
+    uint8_t _timerCount;
+    esp_timer_handle_t _timer;
+    uint64_t _armedExpiry;      // Expiry the esp_timer is armed for, 0 if none
+    SemaphoreHandle_t _mutex;   // A mutex, not a spinlock, so esp_timer can be armed while holding it
+    StaticSemaphore_t _mutexBuffer;
+
+    TimerService(const TimerService&);
+    TimerService& operator=(const TimerService&);
+
+    bool isValid(TimerId id) const;
+    void schedule(TimerId id, uint64_t expiry);
+    void unschedule(TimerId id);
+    void siftUp(uint8_t position);
+    void siftDown(uint8_t position);
+    void place(uint8_t position, TimerId id);
+    void arm();
+    void dispatch();
+    static void timerCallback(void* arg);
+};
+
+extern TimerService timerService;
+
+#endif // TIMER_SERVICE_H
@@ -0,0 +1,59 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <stdint.h>
+
+// Strong unit types. Each one wraps a single number, so it costs nothing at
+// runtime, but a value in one unit cannot be passed where another is expected.
+template <typename T, typename Tag>
+class Quantity {
+public:
+    constexpr Quantity() : _value(0) {}
+    constexpr explicit Quantity(T value) : _value(value) {}
+    constexpr T value() const { return _value; }
+
+    constexpr Quantity operator+(Quantity other) const { return Quantity(_value + other._value); }
+    constexpr Quantity operator-(Quantity other) const { return Quantity(_value - other._value); }
+    constexpr Quantity operator-() const { return Quantity(-_value); }
+    constexpr Quantity operator*(T factor) const { return Quantity(_value * factor); }
+    constexpr bool operator==(Quantity other) const { return _value == other._value; }
+    constexpr bool operator!=(Quantity other) const { return _value != other._value; }
+    constexpr bool operator<(Quantity other) const { return _value < other._value; }
+    constexpr bool operator>(Quantity other) const { return _value > other._value; }
+    constexpr bool operator<=(Quantity other) const { return _value <= other._value; }
+    constexpr bool operator>=(Quantity other) const { return _value >= other._value; }
+
+private:
+    T _value;
+};
+
+struct StepsTag {};
+struct MillimetresTag {};
+struct MillisTag {};
+struct StepsPerSecondTag {};
+
+typedef Quantity<int32_t, StepsTag> Steps;
+typedef Quantity<float, MillimetresTag> Millimetres;
+typedef Quantity<uint32_t, MillisTag> Millis;
+typedef Quantity<float, StepsPerSecondTag> StepsPerSecond;
+
+// Conversion between travel and motor steps for a lead screw drive. The
+// geometry is a template parameter, so the factor folds into one constant.
+template <int32_t StepsPerRev, int32_t MicronsPerRev>
+struct LeadScrew {
+    static constexpr float STEPS_PER_MM = StepsPerRev * 1000.0f / MicronsPerRev;
+
+    // Truncates towards zero, like the float-to-int casts it replaces
+    static constexpr Steps toSteps(Millimetres distance) {
+        return Steps(static_cast<int32_t>(distance.value() * STEPS_PER_MM));
+    }
+
+    static constexpr Millimetres toMillimetres(Steps steps) {
+        return Millimetres(steps.value() / STEPS_PER_MM);
+    }
+};
+
+// 200 steps * 8 microsteps per revolution, 8mm lead ACME rod
+typedef LeadScrew<1600, 8000> Drive;
+
+#endif // UNITS_H
@@ -0,0 +1,44 @@
+#include "BootProfiler.h"
+
+BootProfiler::BootProfiler() : _count(0), _lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+void BootProfiler::mark(const char* phase) {
+    unsigned long now = micros();
+    // Phases are marked from setup() and from the background network task
+    portENTER_CRITICAL(&_lock);
+    if (_count < MAX_PHASES) {
+        _phases[_count].name = phase;
+        _phases[_count].timestamp = now;
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint8_t BootProfiler::getPhaseCount() const {
+    return _count;
+}
+
+const char* BootProfiler::getPhaseName(uint8_t index) const {
+    return index < _count ? _phases[index].name : "";
+}
+
+unsigned long BootProfiler::getPhaseTime(uint8_t index) const {
+    return index < _count ? _phases[index].timestamp : 0;
+}
+
+unsigned long BootProfiler::getPhaseDuration(uint8_t index) const {
+    if (index >= _count) return 0;
+    unsigned long previous = index > 0 ? _phases[index - 1].timestamp : 0;
+    return _phases[index].timestamp - previous;
+}
+
+unsigned long BootProfiler::getTotalTime() const {
+    return _count > 0 ? _phases[_count - 1].timestamp : 0;
+}
+
+void BootProfiler::report(Print& out) const {
+    out.println("Boot phases (us since boot / duration):");
+    for (uint8_t i = 0; i < _count; i++) {
+        out.printf("  %-12s %8lu %8lu\n", _phases[i].name, _phases[i].timestamp, getPhaseDuration(i));
+    }
+}
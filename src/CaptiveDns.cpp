@@ -0,0 +1,92 @@
+#include "CaptiveDns.h"
+
+namespace {
+const uint16_t TYPE_A = 1;
+const uint16_t TYPE_ANY = 255;
+const uint16_t CLASS_IN = 1;
+}
+
+CaptiveDns::CaptiveDns() : _queries(0), _dropped(0) {
+    setAddress(IPAddress(0u));
+}
+
+bool CaptiveDns::begin(IPAddress address, uint16_t port) {
+    setAddress(address);
+    if (!_udp.listen(port)) return false;
+    _udp.onPacket(packetWrapper, this);
+    return true;
+}
+
+void CaptiveDns::stop() {
+    _udp.close();
+}
+
+uint32_t CaptiveDns::getQueryCount() const {
+    return _queries;
+}
+
+uint32_t CaptiveDns::getDroppedCount() const {
+    return _dropped;
+}
+
+// Header: authoritative reply, one question, one answer. Answer: pointer to
+// the question name, type A, class IN, TTL, then the 4-byte address.
+void CaptiveDns::setAddress(IPAddress address) {
+    const uint8_t header[HEADER_SIZE] = {0, 0, 0x84, 0x00, 0, 1, 0, 1, 0, 0, 0, 0};
+    memcpy(_header, header, sizeof(_header));
+
+    const uint8_t answer[ANSWER_SIZE - 4] = {
+        0xc0, HEADER_SIZE, 0, TYPE_A, 0, CLASS_IN,
+        static_cast<uint8_t>(TTL >> 24), static_cast<uint8_t>(TTL >> 16), static_cast<uint8_t>(TTL >> 8), static_cast<uint8_t>(TTL),
+        0, 4};
+    memcpy(_answer, answer, sizeof(answer));
+    uint32_t raw = address;  // Network byte order in memory
+    memcpy(&_answer[sizeof(answer)], &raw, 4);
+}
+
+size_t CaptiveDns::buildResponse(const uint8_t* query, size_t length, uint8_t* out) const {
+    // A standard query (QR and opcode 0) with exactly one question
+    if (length < HEADER_SIZE + 5 || (query[2] & 0xf8) != 0) return 0;
+    if (query[4] != 0 || query[5] != 1) return 0;
+
+    // Walk the labels of the name, queries do not use compression
+    size_t end = HEADER_SIZE;
+    while (query[end] != 0) {
+        if (query[end] > 63) return 0;
+        end += query[end] + 1;
+        if (end >= length || end - HEADER_SIZE >= MAX_NAME_SIZE) return 0;
+    }
+    end += 5;  // The terminating zero, type and class
+    if (end > length) return 0;
+    uint16_t type = (query[end - 4] << 8) | query[end - 3];
+    uint16_t queryClass = (query[end - 2] << 8) | query[end - 1];
+
+    // Additional records such as EDNS options are not echoed, the template says none
+    memcpy(out, _header, HEADER_SIZE);
+    out[0] = query[0];
+    out[1] = query[1];
+    out[2] |= query[2] & 0x01;  // Recursion desired
+    memcpy(&out[HEADER_SIZE], &query[HEADER_SIZE], end - HEADER_SIZE);
+    if ((type != TYPE_A && type != TYPE_ANY) || queryClass != CLASS_IN) {
+        out[7] = 0;  // No data for other types, but the name exists
+        return end;
+    }
+    memcpy(&out[end], _answer, ANSWER_SIZE);
+    return end + ANSWER_SIZE;
+}
+
+void CaptiveDns::packetWrapper(void* parameter, AsyncUDPPacket& packet) {
+    static_cast<CaptiveDns*>(parameter)->handlePacket(packet);
+}
+
+// Runs in the lwIP receive task
+void CaptiveDns::handlePacket(AsyncUDPPacket& packet) {
+    _queries++;
+    uint8_t response[MAX_RESPONSE_SIZE];
+    size_t length = buildResponse(packet.data(), packet.length(), response);
+    if (length == 0) {
+        _dropped++;
+        return;
+    }
+    packet.write(response, length);
+}
@@ -0,0 +1,273 @@
+#include "CycleLog.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+
+namespace {
+    const char* DIRECTORY = "/cycles";
+}
+
+CycleLog::CycleLog()
+    : _ready(false), _queueHead(0), _queueCount(0), _oldestQueued(0), _dropped(0), _firstSegment(0),
+      _lastSegment(0), _segmentSealed(false), _nextSequence(0), _boot(0) {
+    memset(_segmentRecords, 0, sizeof(_segmentRecords));
+}
+
+// Mounts the file system and finds the segments. Slow on first use while the
+// partition is formatted, so it runs in the network task; the loop only
+// writes and reads once it is done.
+bool CycleLog::begin() {
+    if (!LittleFS.begin(true)) return false;
+    if (!LittleFS.exists(DIRECTORY)) {
+        LittleFS.mkdir(DIRECTORY);
+    }
+
+    bool found = false;
+    File directory = LittleFS.open(DIRECTORY);
+    File file = directory.openNextFile();
+    while (file) {
+        if (!file.isDirectory()) {
+            // Older cores return the full path, newer ones only the file name
+            const char* name = strrchr(file.name(), '/');
+            uint32_t segment = strtoul(name ? name + 1 : file.name(), NULL, 10);
+            if (!found || segment < _firstSegment) _firstSegment = segment;
+            if (!found || segment > _lastSegment) _lastSegment = segment;
+            found = true;
+        }
+        file = directory.openNextFile();
+    }
+    directory.close();
+
+    char path[24];
+    while (_lastSegment - _firstSegment >= MAX_SEGMENTS) {
+        segmentPath(_firstSegment++, path);
+        LittleFS.remove(path);
+    }
+
+    size_t lastSize = 0;
+    for (uint32_t segment = _firstSegment; found && segment <= _lastSegment; segment++) {
+        segmentPath(segment, path);
+        size_t size = 0;
+        if (LittleFS.exists(path)) {
+            File segmentFile = LittleFS.open(path, FILE_READ);
+            size = segmentFile.size();
+            segmentFile.close();
+        }
+        _segmentRecords[segment % MAX_SEGMENTS] = size / RECORD_SIZE;
+        lastSize = size;
+    }
+    _segmentSealed = lastSize % RECORD_SIZE != 0;
+
+    // Carry the cycle numbering on from the newest intact record
+    uint16_t lastCount = _segmentRecords[_lastSegment % MAX_SEGMENTS];
+    if (lastCount > 0) {
+        segmentPath(_lastSegment, path);
+        File segmentFile = LittleFS.open(path, FILE_READ);
+        uint8_t data[RECORD_SIZE];
+        Record record;
+        for (int32_t i = lastCount - 1; i >= 0; i--) {
+            if (segmentFile.seek(i * RECORD_SIZE) && segmentFile.read(data, RECORD_SIZE) == RECORD_SIZE &&
+                decode(data, record)) {
+                _nextSequence = record.sequence + 1;
+                break;
+            }
+        }
+        segmentFile.close();
+    }
+
+    Preferences preferences;
+    preferences.begin("cyclelog", false);
+    _boot = preferences.getUShort("boot", 0) + 1;
+    preferences.putUShort("boot", _boot);
+    preferences.end();
+
+    _ready = true;
+    return true;
+}
+
+bool CycleLog::isReady() const {
+    return _ready;
+}
+
+// Queues a finished cycle, false when the queue is full and the record is lost
+bool CycleLog::append(const Record& record, unsigned long now) {
+    if (_queueCount == QUEUE_SIZE) {
+        _dropped++;
+        return false;
+    }
+    if (_queueCount == 0) {
+        _oldestQueued = now;
+    }
+    _queue[(_queueHead + _queueCount) % QUEUE_SIZE] = record;
+    _queueCount++;
+    return true;
+}
+
+// Once per loop pass: writes the queue once half full or after FLUSH_DELAY, never while a carriage moves
+void CycleLog::service(unsigned long now, bool motionActive) {
+    if (motionActive || _queueCount == 0) return;
+    if (_queueCount >= QUEUE_SIZE / 2 || now - _oldestQueued >= FLUSH_DELAY) {
+        flush();
+    }
+}
+
+// Writes every queued record, one file append per segment touched
+bool CycleLog::flush() {
+    if (!_ready) return false;
+
+    uint8_t buffer[QUEUE_SIZE * RECORD_SIZE];
+    char path[24];
+    while (_queueCount > 0) {
+        if (_segmentSealed || _segmentRecords[_lastSegment % MAX_SEGMENTS] >= SEGMENT_RECORDS) {
+            startSegment();
+        }
+        uint16_t& segmentRecords = _segmentRecords[_lastSegment % MAX_SEGMENTS];
+        uint8_t count = _queueCount;
+        if (count > SEGMENT_RECORDS - segmentRecords) {
+            count = SEGMENT_RECORDS - segmentRecords;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            Record& record = _queue[(_queueHead + i) % QUEUE_SIZE];
+            record.sequence = _nextSequence + i;
+            record.boot = _boot;
+            encode(record, &buffer[i * RECORD_SIZE]);
+        }
+
+        segmentPath(_lastSegment, path);
+        File file = LittleFS.open(path, FILE_APPEND);
+        if (!file) return false;
+        size_t written = file.write(buffer, count * RECORD_SIZE);
+        file.close();
+
+        // A short write, the file system is full; keep what did not make it
+        uint8_t complete = written / RECORD_SIZE;
+        segmentRecords += complete;
+        _nextSequence += complete;
+        _queueHead = (_queueHead + complete) % QUEUE_SIZE;
+        _queueCount -= complete;
+        if (complete < count) {
+            _segmentSealed = written % RECORD_SIZE != 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Records on flash, queued records are not counted until written
+uint32_t CycleLog::getRecordCount() const {
+    if (!_ready) return 0;
+    uint32_t count = 0;
+    for (uint32_t segment = _firstSegment; segment <= _lastSegment; segment++) {
+        count += _segmentRecords[segment % MAX_SEGMENTS];
+    }
+    return count;
+}
+
+// Copies the encoded record at index, oldest first, into out (RECORD_SIZE bytes)
+bool CycleLog::readRecord(uint32_t index, uint8_t* out) {
+    if (!_ready) return false;
+    for (uint32_t segment = _firstSegment; segment <= _lastSegment; segment++) {
+        uint16_t count = _segmentRecords[segment % MAX_SEGMENTS];
+        if (index < count) {
+            char path[24];
+            segmentPath(segment, path);
+            File file = LittleFS.open(path, FILE_READ);
+            bool ok = file && file.seek(index * RECORD_SIZE) && file.read(out, RECORD_SIZE) == RECORD_SIZE;
+            file.close();
+            return ok;
+        }
+        index -= count;
+    }
+    return false;
+}
+
+uint32_t CycleLog::getDroppedCount() const {
+    return _dropped;
+}
+
+void CycleLog::encode(const Record& record, uint8_t* out) {
+    out[0] = MAGIC_0;
+    out[1] = MAGIC_1;
+    out[2] = VERSION;
+    out[3] = record.station;
+    putU32(&out[4], record.sequence);
+    putU16(&out[8], record.boot);
+    out[10] = record.endReason;
+    out[11] = 0;
+    putU32(&out[12], record.startTime);
+    putU32(&out[16], record.cookTime);
+    putU32(&out[20], record.totalDistance);
+    putU16(&out[24], record.speed);
+    putU16(&out[26], record.strokes);
+    putU32(&out[28], record.duration);
+    putU32(&out[32], record.heaterOnTime);
+    putU32(&out[36], record.peakLatency);
+    putU32(&out[40], crc32(out, RECORD_SIZE - 4));
+}
+
+// False for a torn or foreign record
+bool CycleLog::decode(const uint8_t* data, Record& record) {
+    if (data[0] != MAGIC_0 || data[1] != MAGIC_1 || data[2] != VERSION) return false;
+    if (getU32(&data[40]) != crc32(data, RECORD_SIZE - 4)) return false;
+    record.station = data[3];
+    record.sequence = getU32(&data[4]);
+    record.boot = getU16(&data[8]);
+    record.endReason = data[10];
+    record.startTime = getU32(&data[12]);
+    record.cookTime = getU32(&data[16]);
+    record.totalDistance = getU32(&data[20]);
+    record.speed = getU16(&data[24]);
+    record.strokes = getU16(&data[26]);
+    record.duration = getU32(&data[28]);
+    record.heaterOnTime = getU32(&data[32]);
+    record.peakLatency = getU32(&data[36]);
+    return true;
+}
+
+// The current segment is full or ends in a torn record; drops the oldest one past MAX_SEGMENTS
+void CycleLog::startSegment() {
+    _lastSegment++;
+    if (_lastSegment - _firstSegment >= MAX_SEGMENTS) {
+        char path[24];
+        segmentPath(_firstSegment++, path);
+        LittleFS.remove(path);
+    }
+    _segmentRecords[_lastSegment % MAX_SEGMENTS] = 0;
+    _segmentSealed = false;
+}
+
+void CycleLog::segmentPath(uint32_t segment, char* path) {
+    snprintf(path, 24, "%s/%08lu.log", DIRECTORY, static_cast<unsigned long>(segment));
+}
+
+// CRC-32 as used by zlib, bitwise since it only runs when a record is written or read back
+uint32_t CycleLog::crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+void CycleLog::putU16(uint8_t* out, uint16_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+void CycleLog::putU32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+uint16_t CycleLog::getU16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+uint32_t CycleLog::getU32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
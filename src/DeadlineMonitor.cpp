@@ -0,0 +1,136 @@
+#include "DeadlineMonitor.h"
+#include <esp_task_wdt.h>
+
+DeadlineMonitor::DeadlineMonitor()
+    : _totalOverruns(0), _iterationState(0), _iterationStart(0), _iterationStarted(false),
+      _safeOutputs(NULL), _guardTimer(NULL), _guardTimeout(0), _watchdogEnabled(false),
+      _lastCheckIn(0), _tripped(false), _tripCount(0) {
+    for (uint8_t i = 0; i < MAX_STATES; i++) {
+        _stats[i].budget = UINT32_MAX;
+    }
+    resetStats();
+}
+
+void DeadlineMonitor::setBudget(uint8_t state, uint32_t budget) {
+    if (state < MAX_STATES) {
+        _stats[state].budget = budget;
+    }
+}
+
+// guardTimeout in milliseconds, watchdogTimeout in seconds; call from the loop task
+void DeadlineMonitor::begin(SafeOutputsFunction safeOutputs, uint32_t guardTimeout, uint32_t watchdogTimeout) {
+    _safeOutputs = safeOutputs;
+    _guardTimeout = guardTimeout * 1000;
+    _lastCheckIn = micros();
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = guardCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "deadline";
+    if (esp_timer_create(&timerArgs, &_guardTimer) == ESP_OK) {
+        esp_timer_start_periodic(_guardTimer, GUARD_PERIOD);
+    }
+
+    // Reconfigures the task watchdog the core has already started, with a panic reset on timeout
+    if (esp_task_wdt_init(watchdogTimeout, true) == ESP_OK && esp_task_wdt_add(NULL) == ESP_OK) {
+        _watchdogEnabled = true;
+    }
+}
+
+// Once per loop() pass: closes the previous iteration and starts one for the current state
+void DeadlineMonitor::loopCheckIn(uint8_t state) {
+    unsigned long now = micros();
+
+    if (_iterationStarted && _iterationState < MAX_STATES) {
+        Stats& stats = _stats[_iterationState];
+        uint32_t duration = now - _iterationStart;
+        stats.iterations++;
+        if (duration > stats.worst) {
+            stats.worst = duration;
+        }
+        if (duration > stats.budget) {
+            stats.overruns++;
+            stats.lastOverrunTime = millis();
+            _totalOverruns++;
+        }
+    }
+
+    _iterationState = state;
+    _iterationStart = now;
+    _iterationStarted = true;
+    checkIn();
+}
+
+// Keeps the guard and the watchdog quiet, for code that legitimately blocks inside one iteration
+void DeadlineMonitor::checkIn() {
+    _lastCheckIn = micros();
+    if (_watchdogEnabled) {
+        esp_task_wdt_reset();
+    }
+}
+
+// Leaves the current iteration out of the stats, for passes that sleep on purpose
+void DeadlineMonitor::discardIteration() {
+    _iterationStarted = false;
+    checkIn();
+}
+
+bool DeadlineMonitor::hasTripped() const {
+    return _tripped;
+}
+
+void DeadlineMonitor::clearTrip() {
+    _tripped = false;
+}
+
+uint32_t DeadlineMonitor::getTripCount() const {
+    return _tripCount;
+}
+
+const DeadlineMonitor::Stats& DeadlineMonitor::getStats(uint8_t state) const {
+    return _stats[state < MAX_STATES ? state : 0];
+}
+
+uint32_t DeadlineMonitor::getTotalOverruns() const {
+    return _totalOverruns;
+}
+
+void DeadlineMonitor::resetStats() {
+    for (uint8_t i = 0; i < MAX_STATES; i++) {
+        _stats[i].worst = 0;
+        _stats[i].iterations = 0;
+        _stats[i].overruns = 0;
+        _stats[i].lastOverrunTime = 0;
+    }
+    _totalOverruns = 0;
+    _iterationStarted = false;  // The iteration in progress may straddle the reset
+}
+
+void DeadlineMonitor::report(Print& out, StateNameFunction stateName) const {
+    out.printf("Loop deadlines (budget / worst us, overruns of iterations, last overrun ms), %lu guard trips:\n",
+               static_cast<unsigned long>(_tripCount));
+    for (uint8_t i = 0; i < MAX_STATES; i++) {
+        const Stats& stats = _stats[i];
+        if (stats.iterations == 0) continue;
+        out.printf("  %-20s %8lu %8lu %6lu / %-8lu %lu\n", stateName(i),
+                   static_cast<unsigned long>(stats.budget), static_cast<unsigned long>(stats.worst),
+                   static_cast<unsigned long>(stats.overruns), static_cast<unsigned long>(stats.iterations),
+                   stats.lastOverrunTime);
+    }
+}
+
+// Runs in the esp_timer task, so it keeps working while the loop task is stuck
+void DeadlineMonitor::guardCallback(void* arg) {
+    DeadlineMonitor* monitor = static_cast<DeadlineMonitor*>(arg);
+    if (micros() - monitor->_lastCheckIn <= monitor->_guardTimeout) return;
+
+    if (!monitor->_tripped) {
+        monitor->_tripped = true;
+        monitor->_tripCount = monitor->_tripCount + 1;
+    }
+    // Repeated every period for as long as the stall lasts
+    if (monitor->_safeOutputs) {
+        monitor->_safeOutputs();
+    }
+}
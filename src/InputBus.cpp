@@ -0,0 +1,108 @@
+#include "InputBus.h"
+
+InputBus::InputBus()
+    : _buttonCount(0), _rotary(NULL), _encoderStation(0), _encoderEvents(0), _head(0), _count(0), _dropped(0),
+      _activity(false) {}
+
+// longPress in ms, 0 if the button has no long press
+bool InputBus::addButton(ButtonHandler& button, InputEvent::Source source, uint8_t station, unsigned long longPress) {
+    if (_buttonCount >= MAX_BUTTONS) return false;
+    Button& entry = _buttons[_buttonCount++];
+    entry.handler = &button;
+    entry.source = source;
+    entry.station = station;
+    entry.longPress = longPress;
+    entry.pressTime = 0;
+    entry.longPressSent = false;
+    return true;
+}
+
+void InputBus::setEncoder(RotaryInput& rotary, uint8_t station) {
+    _rotary = &rotary;
+    _encoderStation = station;
+    _encoderEvents = rotary.getEventCount();
+}
+
+// Reads every input once and queues what changed
+void InputBus::poll(unsigned long currentTime) {
+    for (uint8_t i = 0; i < _buttonCount; i++) {
+        Button& button = _buttons[i];
+        ButtonHandler& handler = *button.handler;
+        handler.update();
+        if (handler.stateChanged()) {
+            handler.reset();
+            if (handler.getState()) {
+                button.pressTime = currentTime;
+                button.longPressSent = false;
+                push(InputEvent::PRESS, button.source, button.station, 0, 0, currentTime);
+            } else {
+                push(InputEvent::RELEASE, button.source, button.station, currentTime - button.pressTime, 0, currentTime);
+            }
+        }
+        if (handler.getState()) {
+            _activity = true;
+            if (button.longPress > 0 && !button.longPressSent && currentTime - button.pressTime >= button.longPress) {
+                button.longPressSent = true;
+                push(InputEvent::LONG_PRESS, button.source, button.station, button.longPress, 0, currentTime);
+            }
+        }
+    }
+
+    if (_rotary != NULL) {
+        uint32_t events = _rotary->getEventCount();
+        if (events != _encoderEvents) {
+            _encoderEvents = events;
+            _activity = true;  // Also for a part of a detent
+        }
+        int32_t detents = _rotary->readDetents();
+        if (detents != 0) {
+            push(InputEvent::ENCODER, InputEvent::SOURCE_ENCODER, _encoderStation, detents, _rotary->accelerate(detents), currentTime);
+        }
+    }
+}
+
+// Oldest event first, false when the queue is empty
+bool InputBus::next(InputEvent& event) {
+    if (_count == 0) return false;
+    event = _queue[_head];
+    _head = (_head + 1) % CAPACITY;
+    _count--;
+    return true;
+}
+
+void InputBus::clear() {
+    _head = 0;
+    _count = 0;
+}
+
+// True when anything was pressed, held or turned since the last call
+bool InputBus::takeActivity() {
+    bool activity = _activity;
+    _activity = false;
+    return activity;
+}
+
+uint8_t InputBus::getCount() const {
+    return _count;
+}
+
+uint32_t InputBus::getDroppedCount() const {
+    return _dropped;
+}
+
+// A full queue keeps the older events, which the consumer has not seen yet either
+void InputBus::push(InputEvent::Type type, InputEvent::Source source, uint8_t station, int32_t value, int32_t steps, unsigned long time) {
+    _activity = true;
+    if (_count == CAPACITY) {
+        _dropped++;
+        return;
+    }
+    InputEvent& event = _queue[(_head + _count) % CAPACITY];
+    event.type = type;
+    event.source = source;
+    event.station = station;
+    event.value = value;
+    event.steps = steps;
+    event.time = time;
+    _count++;
+}
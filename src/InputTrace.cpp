@@ -0,0 +1,101 @@
+#include "InputTrace.h"
+
+static const int32_t EXPORT_HEADER = -1;
+static const int32_t EXPORT_IDLE = -2;
+
+InputTrace::InputTrace()
+    : _pinCount(0), _rotary(NULL), _encoderEvents(0), _encoderCount(0), _count(0), _dropped(0), _lastLevels(0),
+      _started(false), _exportIndex(EXPORT_IDLE), _exportCount(0) {}
+
+bool InputTrace::addPin(uint8_t pin) {
+    if (_pinCount >= MAX_PINS) return false;
+    _pins[_pinCount++] = pin;
+    return true;
+}
+
+void InputTrace::setEncoder(RotaryInput& rotary) {
+    _rotary = &rotary;
+    _encoderEvents = rotary.getEventCount();
+    _encoderCount = rotary.getCount();
+}
+
+// Once per loop pass, just before the inputs are polled
+void InputTrace::sample() {
+    uint16_t levels = 0;
+    for (uint8_t i = 0; i < _pinCount; i++) {
+        if (digitalRead(_pins[i])) {
+            levels |= 1 << i;
+        }
+    }
+
+    // The counter is only read when the encoder interrupt says it moved
+    int32_t encoderDelta = 0;
+    if (_rotary != NULL && _rotary->getEventCount() != _encoderEvents) {
+        _encoderEvents = _rotary->getEventCount();
+        int64_t count = _rotary->getCount();
+        encoderDelta = constrain(count - _encoderCount, INT16_MIN, INT16_MAX);
+        _encoderCount += encoderDelta;
+    }
+
+    if (_started && levels == _lastLevels && encoderDelta == 0) return;
+    _started = true;
+    _lastLevels = levels;
+
+    // Full: keep the session from boot, which is what a replay starts from
+    if (_count == CAPACITY) {
+        _dropped++;
+        return;
+    }
+    Record& record = _records[_count];
+    record.time = micros();
+    record.levels = levels;
+    record.encoderDelta = encoderDelta;
+    _count++;
+}
+
+// Exports the records present now, recording carries on behind them; false if an export is running
+bool InputTrace::startExport() {
+    if (_exportIndex != EXPORT_IDLE) return false;
+    _exportIndex = EXPORT_HEADER;
+    _exportCount = _count;
+    return true;
+}
+
+// Writes whole lines while room lasts, so a caller passing the free transmit
+// buffer never blocks on the UART. True while lines are left.
+bool InputTrace::exportTo(Print& out, size_t room) {
+    char line[MAX_LINE_LENGTH];
+    while (_exportIndex != EXPORT_IDLE && room >= MAX_LINE_LENGTH) {
+        int length;
+        if (_exportIndex == EXPORT_HEADER) {
+            length = snprintf(line, sizeof(line), "# input-trace %u pins ", FORMAT_VERSION);
+            for (uint8_t i = 0; i < _pinCount; i++) {
+                length += snprintf(line + length, sizeof(line) - length, i > 0 ? ",%u" : "%u", _pins[i]);
+            }
+            length += snprintf(line + length, sizeof(line) - length, " records %u dropped %lu\n", _exportCount,
+                               static_cast<unsigned long>(_dropped));
+        } else if (_exportIndex < _exportCount) {
+            const Record& record = _records[_exportIndex];
+            length = snprintf(line, sizeof(line), "%lu %x %d\n", static_cast<unsigned long>(record.time), record.levels,
+                              record.encoderDelta);
+        } else {
+            length = snprintf(line, sizeof(line), "# end\n");
+        }
+        out.write(reinterpret_cast<const uint8_t*>(line), length);
+        room -= length;
+        _exportIndex = _exportIndex < _exportCount ? _exportIndex + 1 : EXPORT_IDLE;
+    }
+    return _exportIndex != EXPORT_IDLE;
+}
+
+bool InputTrace::isExporting() const {
+    return _exportIndex != EXPORT_IDLE;
+}
+
+uint16_t InputTrace::getCount() const {
+    return _count;
+}
+
+uint32_t InputTrace::getDroppedCount() const {
+    return _dropped;
+}
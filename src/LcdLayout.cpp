@@ -0,0 +1,98 @@
+#include "LcdLayout.h"
+
+LcdLayout::LcdLayout(MatrixDisplay& display) : _display(display), _screen(NULL) {
+    invalidate();
+}
+
+// Call after MatrixDisplay::begin()
+void LcdLayout::begin() {
+    for (uint8_t columns = 1; columns <= CELL_STEPS; columns++) {
+        uint8_t row = static_cast<uint8_t>(0x1F << (CELL_STEPS - columns)) & 0x1F;
+        const uint8_t pattern[8] = {0, row, row, row, row, row, row, 0};
+        _display.defineGlyph(FIRST_GLYPH + columns - 1, pattern);
+    }
+}
+
+// Draws the fixed text, the fields follow with their next set()
+void LcdLayout::show(const Screen& screen) {
+    _screen = &screen;
+    invalidate();
+    _display.updateDisplay(screen.row1, screen.row2);
+}
+
+bool LcdLayout::isShowing(const Screen& screen) const {
+    return _screen == &screen;
+}
+
+// Forgets the screen, for when other text replaces it; show() draws it again
+void LcdLayout::hide() {
+    _screen = NULL;
+}
+
+// Redraws every field on its next set(), for when something else drew on the display
+void LcdLayout::invalidate() {
+    for (uint8_t i = 0; i < MAX_FIELDS; i++) {
+        _valid[i] = false;
+    }
+}
+
+void LcdLayout::set(uint8_t field, int32_t value) {
+    if (_screen == NULL || field >= _screen->fieldCount || field >= MAX_FIELDS) return;
+    if (_valid[field] && _values[field] == value) return;
+    _values[field] = value;
+    _valid[field] = true;
+
+    const Field& info = _screen->fields[field];
+    uint8_t width = info.width < MAX_FIELD_WIDTH ? info.width : MAX_FIELD_WIDTH;
+    char text[MAX_FIELD_WIDTH];
+    if (info.type == FIELD_BAR) {
+        formatBar(value, width, text);
+    } else {
+        formatNumber(value, info.decimals, width, text);
+    }
+    _display.writeField(info.row, info.col, text, width);
+}
+
+// Right-aligned in width characters, padded with spaces, '#' when it does not fit; returns width
+uint8_t LcdLayout::formatNumber(int32_t value, uint8_t decimals, uint8_t width, char* out) {
+    bool negative = value < 0;
+    uint32_t magnitude = negative ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+
+    int8_t pos = width - 1;
+    uint8_t digits = 0;
+    do {
+        if (pos < 0) break;
+        if (decimals > 0 && digits == decimals) {
+            out[pos--] = '.';
+            if (pos < 0) break;
+        }
+        out[pos--] = '0' + magnitude % 10;
+        magnitude /= 10;
+        digits++;
+    } while (magnitude > 0 || digits <= decimals);
+
+    if (negative && pos >= 0) {
+        out[pos--] = '-';
+    } else if (negative) {
+        magnitude = 1;  // No room for the sign
+    }
+    if (magnitude > 0 || (decimals > 0 && digits <= decimals)) {
+        memset(out, '#', width);
+        return width;
+    }
+    while (pos >= 0) {
+        out[pos--] = ' ';
+    }
+    return width;
+}
+
+void LcdLayout::formatBar(int32_t value, uint8_t width, char* out) {
+    if (value < 0) value = 0;
+    if (value > PROGRESS_FULL) value = PROGRESS_FULL;
+    uint32_t steps = static_cast<uint32_t>(value) * width * CELL_STEPS / PROGRESS_FULL;
+    for (uint8_t i = 0; i < width; i++) {
+        uint32_t lit = steps > CELL_STEPS ? CELL_STEPS : steps;
+        out[i] = lit == 0 ? ' ' : static_cast<char>(FIRST_GLYPH + lit - 1);
+        steps -= lit;
+    }
+}
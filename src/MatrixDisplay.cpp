@@ -1,13 +1,14 @@
 #include "MatrixDisplay.h"
-#include <queue>
 
 MatrixDisplay::MatrixDisplay(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows)
-    : _lcd(lcd_addr, lcd_cols, lcd_rows), _cols(lcd_cols), _rows(lcd_rows),
-      _buffer(_rows, std::vector<char>(_cols, ' ')),
-      _updateNeeded(false), _updateTaskHandle(NULL), _bufferMutex(NULL),
-      _messageQueueMutex(NULL), _currentMessageEndTime(0) {
-    _bufferMutex = xSemaphoreCreateMutex();
-    _messageQueueMutex = xSemaphoreCreateMutex();
+    : _lcd(lcd_addr, lcd_cols, lcd_rows), _cols(lcd_cols < MAX_COLS ? lcd_cols : MAX_COLS), _rows(lcd_rows < MAX_ROWS ? lcd_rows : MAX_ROWS),
+      _shownValid(false), _updateNeeded(false), _updateTaskHandle(NULL), _bufferMutex(NULL),
+      _lcdMutex(NULL), _messageQueueMutex(NULL), _messageHead(0), _messageCount(0), _currentMessageEndTime(0) {
+    _buffer.fill(' ');
+    _shown.fill(' ');
+    _bufferMutex = xSemaphoreCreateMutexStatic(&_bufferMutexBuffer);
+    _lcdMutex = xSemaphoreCreateMutexStatic(&_lcdMutexBuffer);
+    _messageQueueMutex = xSemaphoreCreateMutexStatic(&_messageQueueMutexBuffer);
 }
 
 void MatrixDisplay::begin() {
@@ -18,25 +19,26 @@ void MatrixDisplay::begin() {
 void MatrixDisplay::updateDisplay(const String& row1, const String& row2, unsigned long displayDuration) {
     if (xSemaphoreTake(_messageQueueMutex, portMAX_DELAY) == pdTRUE) {
         unsigned long currentTime = millis();
-        DisplayMessage newMessage = {row1, row2, currentTime + displayDuration};
+        DisplayMessage newMessage;
+        setMessage(newMessage, row1.c_str(), row2.c_str(), currentTime + displayDuration);
 
         if (displayDuration > 0) {
-            if (_messageQueue.empty() || currentTime >= _currentMessageEndTime) {
+            if (_messageCount == 0 || currentTime >= _currentMessageEndTime) {
                 // If queue is empty or current message has expired, display immediately
-                _messageQueue = std::queue<DisplayMessage>();  // Clear the queue
-                _messageQueue.push(newMessage);
+                clearMessages();
+                pushMessage(newMessage);
                 _currentMessageEndTime = newMessage.endTime;
                 updateBufferWithMessage(newMessage);
             } else {
                 // Add to queue, replacing any existing queued message
-                if (_messageQueue.size() > 1) {
-                    _messageQueue.pop();  // Remove the old queued message
+                if (_messageCount > 1) {
+                    popMessage();  // Remove the old queued message
                 }
-                _messageQueue.push(newMessage);
+                pushMessage(newMessage);
             }
         } else {
             // For immediate display (duration = 0), clear queue and display
-            _messageQueue = std::queue<DisplayMessage>();
+            clearMessages();
             updateBufferWithMessage(newMessage);
         }
 
@@ -44,6 +46,47 @@ void MatrixDisplay::updateDisplay(const String& row1, const String& row2, unsign
     }
 }
 
+// Immediate display straight from C strings, no String copies for screens redrawn often
+void MatrixDisplay::updateDisplay(const char* row1, const char* row2) {
+    if (xSemaphoreTake(_messageQueueMutex, portMAX_DELAY) == pdTRUE) {
+        clearMessages();
+        if (xSemaphoreTake(_bufferMutex, portMAX_DELAY) == pdTRUE) {
+            fillBuffer(row1, row2);
+            _updateNeeded = true;
+            xSemaphoreGive(_bufferMutex);
+        }
+        xSemaphoreGive(_messageQueueMutex);
+    }
+}
+
+// Overwrites length characters of one row in place, the rest of the screen stays.
+// Like the immediate updateDisplay(), it drops any timed messages.
+void MatrixDisplay::writeField(uint8_t row, uint8_t col, const char* text, uint8_t length) {
+    if (row >= _rows || col >= _cols) return;
+    if (length > _cols - col) {
+        length = _cols - col;
+    }
+    if (xSemaphoreTake(_messageQueueMutex, portMAX_DELAY) == pdTRUE) {
+        clearMessages();
+        if (xSemaphoreTake(_bufferMutex, portMAX_DELAY) == pdTRUE) {
+            memcpy(&_buffer[row * _cols + col], text, length);
+            _updateNeeded = true;
+            xSemaphoreGive(_bufferMutex);
+        }
+        xSemaphoreGive(_messageQueueMutex);
+    }
+}
+
+// Loads a custom character into CGRAM slot 0-7, shown by writing that code
+void MatrixDisplay::defineGlyph(uint8_t slot, const uint8_t pattern[8]) {
+    uint8_t rows[8];
+    memcpy(rows, pattern, sizeof(rows));
+    if (xSemaphoreTake(_lcdMutex, portMAX_DELAY) == pdTRUE) {
+        _lcd.createChar(slot & 0x07, rows);
+        xSemaphoreGive(_lcdMutex);
+    }
+}
+
 void MatrixDisplay::updateBufferWithMessage(const DisplayMessage& message) {
     if (xSemaphoreTake(_bufferMutex, portMAX_DELAY) == pdTRUE) {
         fillBuffer(message.row1, message.row2);
@@ -57,58 +100,112 @@ void MatrixDisplay::updateTask() {
         unsigned long currentTime = millis();
 
         if (xSemaphoreTake(_messageQueueMutex, portMAX_DELAY) == pdTRUE) {
-            if (!_messageQueue.empty() && currentTime >= _currentMessageEndTime) {
-                DisplayMessage nextMessage = _messageQueue.front();
-                _messageQueue.pop();
+            if (_messageCount > 0 && currentTime >= _currentMessageEndTime) {
+                const DisplayMessage& nextMessage = _messages[_messageHead];
                 _currentMessageEndTime = nextMessage.endTime;
                 updateBufferWithMessage(nextMessage);
+                popMessage();
             }
             xSemaphoreGive(_messageQueueMutex);
         }
 
         if (_updateNeeded) {
+            _updateNeeded = false;  // Before the copy, so a write during the transfer is drawn next time
             updateChangedCharacters();
-            _updateNeeded = false;
         }
 
         vTaskDelay(pdMS_TO_TICKS(50));  // Check for updates every 50ms
     }
 }
 
+// Writes only the characters that differ from the LCD, and moves the cursor
+// only where the LCD's own auto-increment does not already put it. The
+// transfer works from a copy, so writers never wait for the I2C bus.
 void MatrixDisplay::updateChangedCharacters() {
-    if (xSemaphoreTake(_bufferMutex, portMAX_DELAY) == pdTRUE) {
+    std::array<char, MAX_ROWS * MAX_COLS> frame;
+    if (xSemaphoreTake(_bufferMutex, portMAX_DELAY) != pdTRUE) return;
+    frame = _buffer;
+    xSemaphoreGive(_bufferMutex);
+
+    if (xSemaphoreTake(_lcdMutex, portMAX_DELAY) == pdTRUE) {
         for (int row = 0; row < _rows; row++) {
+            int cursor = -1;  // Column the next write lands on, -1 if unknown
             for (int col = 0; col < _cols; col++) {
-                _lcd.setCursor(col, row);
-                _lcd.write(_buffer[row][col]);
+                int i = row * _cols + col;
+                if (_shownValid && _shown[i] == frame[i]) continue;
+                if (cursor != col) {
+                    _lcd.setCursor(col, row);
+                }
+                _lcd.write(frame[i]);
+                _shown[i] = frame[i];
+                cursor = col + 1;
             }
         }
-        xSemaphoreGive(_bufferMutex);
+        _shownValid = true;
+        xSemaphoreGive(_lcdMutex);
     }
 }
 
 void MatrixDisplay::fillBuffer(const String& row1, const String& row2) {
-    const String rows[2] = {row1, row2};
+    fillBuffer(row1.c_str(), row2.c_str());
+}
+
+void MatrixDisplay::fillBuffer(const char* row1, const char* row2) {
+    const char* rows[2] = {row1, row2};
     for (int i = 0; i < _rows; i++) {
-        const String& row = rows[i];
-        int len = std::min(static_cast<int>(row.length()), static_cast<int>(_cols));
-        std::copy(row.begin(), row.begin() + len, _buffer[i].begin());
-        std::fill(_buffer[i].begin() + len, _buffer[i].end(), ' ');
+        const char* row = i < 2 ? rows[i] : "";
+        char* line = &_buffer[i * _cols];
+        int len = strnlen(row, _cols);
+        memcpy(line, row, len);
+        memset(line + len, ' ', _cols - len);
     }
 }
 
+void MatrixDisplay::setMessage(DisplayMessage& message, const char* row1, const char* row2, unsigned long endTime) {
+    strncpy(message.row1, row1, MAX_COLS);
+    message.row1[MAX_COLS] = '\0';
+    strncpy(message.row2, row2, MAX_COLS);
+    message.row2[MAX_COLS] = '\0';
+    message.endTime = endTime;
+}
+
+// Fixed ring of MESSAGE_SLOTS messages, callers hold _messageQueueMutex
+void MatrixDisplay::clearMessages() {
+    _messageHead = 0;
+    _messageCount = 0;
+}
+
+void MatrixDisplay::pushMessage(const DisplayMessage& message) {
+    if (_messageCount == MESSAGE_SLOTS) {
+        popMessage();  // Drop the oldest rather than grow
+    }
+    _messages[(_messageHead + _messageCount) % MESSAGE_SLOTS] = message;
+    _messageCount++;
+}
+
+void MatrixDisplay::popMessage() {
+    if (_messageCount == 0) return;
+    _messageHead = (_messageHead + 1) % MESSAGE_SLOTS;
+    _messageCount--;
+}
+
 void MatrixDisplay::startUpdateThread() {
-    xTaskCreatePinnedToCore(
+    _updateTaskHandle = xTaskCreateStaticPinnedToCore(
         updateTaskWrapper,
         "UpdateDisplay",
-        2048,
+        UPDATE_TASK_STACK_SIZE,
         this,
         1,  // Lower priority
-        &_updateTaskHandle,
+        _updateTaskStack,
+        &_updateTaskBuffer,
         0   // Run on core 0
     );
 }
 
+TaskHandle_t MatrixDisplay::getUpdateTaskHandle() const {
+    return _updateTaskHandle;
+}
+
 void MatrixDisplay::stopUpdateThread() {
     if (_updateTaskHandle != NULL) {
         vTaskDelete(_updateTaskHandle);
@@ -123,6 +220,9 @@ MatrixDisplay::~MatrixDisplay() {
     if (_bufferMutex != NULL) {
         vSemaphoreDelete(_bufferMutex);
     }
+    if (_lcdMutex != NULL) {
+        vSemaphoreDelete(_lcdMutex);
+    }
     if (_messageQueueMutex != NULL) {
         vSemaphoreDelete(_messageQueueMutex);
     }
@@ -0,0 +1,76 @@
+#include "MemoryMonitor.h"
+
+MemoryMonitor::MemoryMonitor() : _count(0), _lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+// A NULL handle registers the calling task
+void MemoryMonitor::addTask(const char* name, TaskHandle_t handle, uint32_t stackSize) {
+    if (handle == NULL) {
+        handle = xTaskGetCurrentTaskHandle();
+    }
+    // Tasks register themselves from either core
+    portENTER_CRITICAL(&_lock);
+    if (_count < MAX_TASKS) {
+        _tasks[_count].name = name;
+        _tasks[_count].handle = handle;
+        _tasks[_count].stackSize = stackSize;
+        _tasks[_count].exitHighWaterMark = 0;
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+// Called by a task right before it deletes itself, so its stack usage stays in the report
+void MemoryMonitor::recordTaskExit() {
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    uint32_t highWaterMark = uxTaskGetStackHighWaterMark(NULL);
+    portENTER_CRITICAL(&_lock);
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_tasks[i].handle == current) {
+            _tasks[i].exitHighWaterMark = highWaterMark;
+            _tasks[i].handle = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+uint8_t MemoryMonitor::getTaskCount() const {
+    return _count;
+}
+
+const char* MemoryMonitor::getTaskName(uint8_t index) const {
+    return index < _count ? _tasks[index].name : "";
+}
+
+uint32_t MemoryMonitor::getStackSize(uint8_t index) const {
+    return index < _count ? _tasks[index].stackSize : 0;
+}
+
+uint32_t MemoryMonitor::getStackHighWaterMark(uint8_t index) const {
+    if (index >= _count) return 0;
+    if (_tasks[index].handle == NULL) return _tasks[index].exitHighWaterMark;
+    return uxTaskGetStackHighWaterMark(_tasks[index].handle);  // Bytes on the ESP32
+}
+
+uint32_t MemoryMonitor::getFreeHeap() const {
+    return ESP.getFreeHeap();
+}
+
+uint32_t MemoryMonitor::getMinFreeHeap() const {
+    return ESP.getMinFreeHeap();
+}
+
+uint32_t MemoryMonitor::getLargestFreeBlock() const {
+    return ESP.getMaxAllocHeap();
+}
+
+void MemoryMonitor::report(Print& out) const {
+    out.printf("Heap: %lu free, %lu minimum, %lu largest block\n", static_cast<unsigned long>(getFreeHeap()),
+               static_cast<unsigned long>(getMinFreeHeap()), static_cast<unsigned long>(getLargestFreeBlock()));
+    out.println("Task stacks (size / peak used bytes):");
+    for (uint8_t i = 0; i < _count; i++) {
+        uint32_t size = _tasks[i].stackSize;
+        uint32_t highWaterMark = getStackHighWaterMark(i);
+        out.printf("  %-14s %6lu %6lu%s\n", _tasks[i].name, static_cast<unsigned long>(size),
+                   static_cast<unsigned long>(size - highWaterMark), _tasks[i].handle == NULL ? " (exited)" : "");
+    }
+}
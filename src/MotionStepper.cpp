@@ -0,0 +1,194 @@
+#include "MotionStepper.h"
+
+MotionStepper::MotionStepper(uint8_t stepPin, uint8_t dirPin)
+    : _stepPin(stepPin), _dirPin(dirPin), _position(0), _direction(0), _pendingInterval(0),
+      _pendingDirection(0), _lastStepTime(0), _idle(true), _worstLateness(0), _queued(false), _planning(false),
+      _underruns(0), _queueHead(0), _queueTail(0), _queueLock(portMUX_INITIALIZER_UNLOCKED) {}
+
+void MotionStepper::setMaxSpeed(float speed) {
+    _planner.setMaxSpeed(static_cast<uint32_t>(speed));
+}
+
+void MotionStepper::setAcceleration(float acceleration) {
+    _planner.setAcceleration(static_cast<uint32_t>(acceleration));
+}
+
+void MotionStepper::setJerk(float jerk) {
+    _planner.setJerk(static_cast<uint32_t>(jerk));
+}
+
+void MotionStepper::moveTo(long absolute) {
+    _planner.setTarget(absolute);
+}
+
+void MotionStepper::move(long relative) {
+    _planner.setTarget(_position + relative);
+}
+
+void MotionStepper::stop() {
+    _planner.stop();
+}
+
+bool MotionStepper::run() {
+    if (_queued) {
+        return fill();
+    }
+    if (_pendingInterval == 0) {
+        _pendingInterval = _planner.nextStep(_pendingDirection);
+        if (_pendingInterval == 0) {
+            _idle = true;
+            return false;
+        }
+        if (_idle) {
+            // First step of a move, time it from now
+            _lastStepTime = micros();
+            _idle = false;
+        }
+    }
+
+    unsigned long now = micros();
+    unsigned long elapsed = now - _lastStepTime;
+    if (elapsed < _pendingInterval) return true;
+
+    if (elapsed - _pendingInterval > _worstLateness) {
+        _worstLateness = elapsed - _pendingInterval;
+    }
+
+    // Don't try to catch up after a stalled loop, that would step faster than planned
+    _lastStepTime = elapsed > 2 * _pendingInterval ? now : _lastStepTime + _pendingInterval;
+    step(_pendingDirection);
+    _pendingInterval = 0;
+    return true;
+}
+
+// Switches between stepping in run() and in pulse(), only while the carriage stands still
+void MotionStepper::setQueued(bool queued) {
+    _queued = queued;
+}
+
+// Plans steps into the queue until QUEUE_AHEAD is queued, true while steps are queued or left to plan
+bool MotionStepper::fill() {
+    uint8_t head = _queueHead.load(std::memory_order_acquire);
+    uint8_t tail = _queueTail.load(std::memory_order_relaxed);
+    bool empty = head == tail;
+    uint32_t ahead = 0;
+    // Part of the first step's interval may have passed already, so only the steps after it count
+    for (uint8_t i = (head + 1) % QUEUE_SIZE; !empty && i != tail; i = (i + 1) % QUEUE_SIZE) {
+        ahead += _queue[i].interval;
+    }
+
+    while (ahead < QUEUE_AHEAD && (tail + 1) % QUEUE_SIZE != head) {
+        QueuedStep& entry = _queue[tail];
+        entry.interval = _planner.nextStep(entry.direction);
+        if (entry.interval == 0) {
+            _planning = false;
+            break;
+        }
+        if (empty && _planning) {
+            _underruns++;
+        }
+        entry.restart = empty;
+        empty = false;
+        _planning = true;
+        ahead += entry.interval;
+        tail = (tail + 1) % QUEUE_SIZE;
+        _queueTail.store(tail, std::memory_order_release);  // Each step is pulse()'s as soon as it is queued
+    }
+    return tail != _queueHead.load(std::memory_order_relaxed) || _planner.isMoving();
+}
+
+// Makes the queued steps that are due, from the timer interrupt. Returns the
+// microseconds until the next one, 0 when the queue is empty.
+uint32_t IRAM_ATTR MotionStepper::pulse(unsigned long now) {
+    uint32_t wait = 0;
+    portENTER_CRITICAL_ISR(&_queueLock);
+    uint8_t head = _queueHead.load(std::memory_order_relaxed);
+    while (head != _queueTail.load(std::memory_order_acquire)) {
+        QueuedStep& entry = _queue[head];
+        if (entry.restart) {
+            _lastStepTime = now;
+            entry.restart = false;
+        }
+        unsigned long elapsed = now - _lastStepTime;
+        if (elapsed < entry.interval) {
+            wait = entry.interval - elapsed;
+            break;
+        }
+        if (elapsed - entry.interval > _worstLateness) {
+            _worstLateness = elapsed - entry.interval;
+        }
+        // Same as run(), no catching up after a late interrupt
+        _lastStepTime = elapsed > 2 * entry.interval ? now : _lastStepTime + entry.interval;
+        step(entry.direction);
+        head = (head + 1) % QUEUE_SIZE;
+        _queueHead.store(head, std::memory_order_release);
+    }
+    portEXIT_CRITICAL_ISR(&_queueLock);
+    return wait;
+}
+
+long MotionStepper::distanceToGo() const {
+    return _planner.getTarget() - _position;
+}
+
+long MotionStepper::targetPosition() const {
+    return _planner.getTarget();
+}
+
+long MotionStepper::currentPosition() const {
+    return _position;
+}
+
+// Also drops the queued steps, so the carriage stops where pulse() left it
+void MotionStepper::setCurrentPosition(long position) {
+    portENTER_CRITICAL(&_queueLock);
+    _queueTail.store(_queueHead.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    _position = position;
+    portEXIT_CRITICAL(&_queueLock);
+    _planner.setPosition(position);
+    _planning = false;
+    _pendingInterval = 0;
+    _idle = true;
+}
+
+// Step jitter caused by the loop polling run() late, or by the timer interrupt when queued
+uint32_t MotionStepper::getWorstLateness() const {
+    return _worstLateness;
+}
+
+uint32_t MotionStepper::getUnderruns() const {
+    return _underruns;
+}
+
+void MotionStepper::resetLateness() {
+    _worstLateness = 0;
+    _underruns = 0;
+}
+
+float MotionStepper::speed() const {
+    return _planner.getSpeed();
+}
+
+float MotionStepper::maxSpeed() const {
+    return _planner.getMaxSpeed();
+}
+
+bool MotionStepper::isRunning() const {
+    return _planner.isMoving() || _pendingInterval != 0 ||
+           _queueHead.load(std::memory_order_relaxed) != _queueTail.load(std::memory_order_relaxed);
+}
+
+bool MotionStepper::isBraking() const {
+    return _planner.isBraking();
+}
+
+void IRAM_ATTR MotionStepper::step(int8_t direction) {
+    if (direction != _direction) {
+        digitalWrite(_dirPin, direction > 0 ? HIGH : LOW);
+        _direction = direction;
+    }
+    digitalWrite(_stepPin, HIGH);
+    delayMicroseconds(1);  // Minimum step pulse width
+    digitalWrite(_stepPin, LOW);
+    _position += direction;
+}
@@ -0,0 +1,187 @@
+#include "MotionTask.h"
+
+MotionTask* MotionTask::_instance = NULL;
+
+MotionTask::MotionTask()
+    : _scheduler(NULL), _timer(NULL), _task(NULL), _running(false), _intervalValid(false), _lastTick(0),
+      _lastWake(0), _timerLock(portMUX_INITIALIZER_UNLOCKED), _resetRequested(false) {
+    clearStats();
+}
+
+// Starts the task and sets up the timer without running it, false if either failed
+bool MotionTask::begin(StationScheduler& scheduler) {
+    _scheduler = &scheduler;
+    _instance = this;
+    _task = xTaskCreateStaticPinnedToCore(taskWrapper, "Motion", STACK_SIZE, this, PRIORITY, _taskStack, &_taskBuffer, CORE);
+    if (_task == NULL) return false;
+
+    _timer = timerBegin(HARDWARE_TIMER, 80, true);  // 1 MHz from the 80 MHz APB clock, at any CPU frequency
+    if (_timer == NULL) {
+        vTaskDelete(_task);
+        _task = NULL;
+        return false;
+    }
+    timerAttachInterrupt(_timer, onTimer, true);
+    return true;
+}
+
+// The timer only runs while a carriage moves, so the task costs nothing at rest; call from the loop task
+void MotionTask::setRunning(bool running) {
+    if (_timer == NULL || running == _running) return;
+    if (running) {
+        _intervalValid = false;
+    }
+    portENTER_CRITICAL(&_timerLock);
+    _running = running;
+    if (running) {
+        _lastWake = micros() - PERIOD;  // The first interrupt wakes the task to fill the queues
+        arm(MIN_ALARM);
+    } else {
+        timerAlarmDisable(_timer);
+    }
+    portEXIT_CRITICAL(&_timerLock);
+}
+
+bool MotionTask::isRunning() const {
+    return _running;
+}
+
+TaskHandle_t MotionTask::getTaskHandle() const {
+    return _task;
+}
+
+void MotionTask::getStats(Stats& stats) const {
+    // The tick count doubles as a sequence number, so the sum and count belong to the same tick
+    uint32_t ticks;
+    uint32_t intervals;
+    uint64_t jitterSum;
+    do {
+        ticks = _ticks;
+        intervals = _intervals;
+        jitterSum = _jitterSum;
+    } while (ticks != _ticks);
+
+    stats.ticks = ticks;
+    stats.missedTicks = _missedTicks;
+    stats.busyStations = _busyStations;
+    stats.worstJitter = _worstJitter;
+    stats.meanJitter = intervals > 0 ? jitterSum / intervals : 0;
+    stats.worstDuration = _worstDuration;
+    stats.interrupts = _interrupts;
+    stats.worstInterrupt = _worstInterrupt;
+}
+
+void MotionTask::resetStats() {
+    if (_running) {
+        _resetRequested = true;
+    } else {
+        clearStats();  // The task is blocked until the timer starts again
+    }
+}
+
+void MotionTask::clearStats() {
+    _ticks = 0;
+    _missedTicks = 0;
+    _busyStations = 0;
+    _worstJitter = 0;
+    _worstDuration = 0;
+    _intervals = 0;
+    _jitterSum = 0;
+    _interrupts = 0;
+    _worstInterrupt = 0;
+    _intervalValid = false;
+    _resetRequested = false;
+}
+
+void MotionTask::run() {
+    while (true) {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (pending > 1) {
+            _missedTicks += pending - 1;
+        }
+        tick();
+    }
+}
+
+void MotionTask::tick() {
+    unsigned long start = micros();
+    if (_resetRequested) {
+        clearStats();
+    }
+
+    // Interval since the previous tick against the timer period
+    if (_intervalValid) {
+        uint32_t interval = start - _lastTick;
+        uint32_t jitter = interval > PERIOD ? interval - PERIOD : PERIOD - interval;
+        _jitterSum += jitter;
+        _intervals++;
+        if (jitter > _worstJitter) {
+            _worstJitter = jitter;
+        }
+    }
+    _lastTick = start;
+    _intervalValid = true;
+
+    _busyStations += _scheduler->serviceMotion();
+
+    // A queue that was empty until now would wait for the next wake, so the interrupt comes now
+    portENTER_CRITICAL(&_timerLock);
+    if (_running) {
+        arm(MIN_ALARM);
+    }
+    portEXIT_CRITICAL(&_timerLock);
+
+    uint32_t duration = micros() - start;
+    if (duration > _worstDuration) {
+        _worstDuration = duration;
+    }
+    _ticks++;
+}
+
+void MotionTask::taskWrapper(void* parameter) {
+    static_cast<MotionTask*>(parameter)->run();
+}
+
+// Fires the interrupt delay microseconds from now, the caller holds _timerLock
+void IRAM_ATTR MotionTask::arm(uint32_t delay) {
+    timerAlarmWrite(_timer, delay > MIN_ALARM ? delay : MIN_ALARM, false);
+    timerWrite(_timer, 0);  // After the alarm, so the count can not be past it already
+    timerAlarmEnable(_timer);
+}
+
+// Makes the due steps, wakes the task once a period, and sets the alarm to the next of the two
+void IRAM_ATTR MotionTask::interrupt() {
+    unsigned long start = micros();
+    uint32_t wait = _scheduler->pulse(start);
+
+    BaseType_t woken = pdFALSE;
+    uint32_t sinceWake = start - _lastWake;
+    if (sinceWake >= PERIOD) {
+        _lastWake = start;
+        sinceWake = 0;
+        vTaskNotifyGiveFromISR(_task, &woken);
+    }
+    if (wait == 0 || wait > PERIOD - sinceWake) {
+        wait = PERIOD - sinceWake;
+    }
+
+    portENTER_CRITICAL_ISR(&_timerLock);
+    if (_running) {
+        uint32_t spent = micros() - start;  // The alarm counts from here
+        arm(wait > spent ? wait - spent : 0);
+    }
+    portEXIT_CRITICAL_ISR(&_timerLock);
+
+    _interrupts++;
+    uint32_t duration = micros() - start;
+    if (duration > _worstInterrupt) {
+        _worstInterrupt = duration;
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void IRAM_ATTR MotionTask::onTimer() {
+    _instance->interrupt();
+}
@@ -0,0 +1,171 @@
+#include "OtaUpdater.h"
+#include <MD5Builder.h>
+#include <Update.h>
+#include <esp32/rom/miniz.h>
+
+OtaUpdater::OtaUpdater() : _server(DEFAULT_PORT), _started(false), _password(""), _error("") {}
+
+void OtaUpdater::begin(const char* password, uint16_t port) {
+    _password = password;
+    _server.begin(port);
+    _server.setNoDelay(true);
+    _started = true;
+}
+
+// Runs the transfer of a waiting client to the end, blocking
+OtaUpdater::Result OtaUpdater::poll(ProgressFunction progress) {
+    if (!_started || !_server.hasClient()) return RESULT_NONE;
+
+    WiFiClient client = _server.available();
+    bool ok = receive(client, progress);
+    if (ok) {
+        client.write(reinterpret_cast<const uint8_t*>("OK\n"), 3);
+    } else {
+        Update.abort();
+        client.write(reinterpret_cast<const uint8_t*>("ERR "), 4);
+        client.write(reinterpret_cast<const uint8_t*>(_error), strlen(_error));
+        client.write(reinterpret_cast<const uint8_t*>("\n"), 1);
+    }
+    client.stop();
+    return ok ? RESULT_OK : RESULT_FAILED;
+}
+
+const char* OtaUpdater::getError() const {
+    return _error;
+}
+
+bool OtaUpdater::receive(WiFiClient& client, ProgressFunction progress) {
+    uint8_t header[HEADER_SIZE];
+    if (!readExact(client, header, HEADER_SIZE, 0, 0, progress)) return false;
+    if (header[0] != 'S' || header[1] != 'K' || header[2] != 'O' || header[3] != 'T') return fail("Bad header");
+
+    uint8_t format = header[4];
+    uint32_t imageSize = getU32(&header[8]);
+    uint32_t payloadSize = getU32(&header[12]);
+    if (format != FORMAT_RAW && format != FORMAT_DEFLATE) return fail("Bad format");
+    if (format == FORMAT_RAW && payloadSize != imageSize) return fail("Bad size");
+
+    // Same password as ArduinoOTA, so this path is no easier to use uninvited
+    MD5Builder auth;
+    auth.begin();
+    auth.add(reinterpret_cast<const uint8_t*>(_password), strlen(_password));
+    auth.add(&header[16], 16);
+    auth.calculate();
+    uint8_t expected[16];
+    auth.getBytes(expected);
+    if (memcmp(expected, &header[32], 16) != 0) return fail("Not authorised");
+
+    char md5[33];
+    for (uint8_t i = 0; i < 16; i++) {
+        snprintf(&md5[i * 2], 3, "%02x", header[16 + i]);
+    }
+    if (!Update.begin(imageSize)) return fail(Update.errorString());
+    Update.setMD5(md5);
+
+    // The inflate state and window only exist for the length of a transfer
+    tinfl_decompressor* decompressor = NULL;
+    uint8_t* window = NULL;
+    if (format == FORMAT_DEFLATE) {
+        decompressor = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+        window = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+        if (decompressor == NULL || window == NULL) {
+            free(decompressor);
+            free(window);
+            return fail("Out of memory");
+        }
+        tinfl_init(decompressor);
+    }
+
+    uint8_t chunk[CHUNK_SIZE];
+    uint32_t remaining = payloadSize;
+    uint32_t written = 0;
+    size_t windowOffset = 0;
+    tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    bool ok = true;
+
+    while (ok && remaining > 0) {
+        size_t length = remaining < CHUNK_SIZE ? remaining : CHUNK_SIZE;
+        if (!readExact(client, chunk, length, written, imageSize, progress)) {
+            ok = false;
+            break;
+        }
+        remaining -= length;
+
+        if (format == FORMAT_RAW) {
+            if (Update.write(chunk, length) != length) {
+                ok = fail(Update.errorString());
+            }
+            written += length;
+            continue;
+        }
+
+        // Inflate into the circular window, writing out whatever each call produced
+        const uint8_t* input = chunk;
+        size_t available = length;
+        do {
+            size_t inputBytes = available;
+            size_t outputBytes = TINFL_LZ_DICT_SIZE - windowOffset;
+            mz_uint32 flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32;
+            if (remaining > 0) flags |= TINFL_FLAG_HAS_MORE_INPUT;
+            status = tinfl_decompress(decompressor, input, &inputBytes, window, window + windowOffset, &outputBytes, flags);
+            input += inputBytes;
+            available -= inputBytes;
+            if (outputBytes > 0) {
+                if (Update.write(window + windowOffset, outputBytes) != outputBytes) {
+                    ok = fail(Update.errorString());
+                    break;
+                }
+                written += outputBytes;
+                windowOffset = (windowOffset + outputBytes) & (TINFL_LZ_DICT_SIZE - 1);
+            }
+            if (status < TINFL_STATUS_DONE) {
+                ok = fail("Bad compressed data");
+                break;
+            }
+        } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+    }
+
+    free(decompressor);
+    free(window);
+    if (!ok) return false;
+    if (format == FORMAT_DEFLATE && status != TINFL_STATUS_DONE) return fail("Truncated image");
+    if (written != imageSize) return fail("Wrong image size");
+    // Checks the MD5 and marks the new partition bootable
+    if (!Update.end()) return fail(Update.errorString());
+    return true;
+}
+
+// Waits for length bytes, giving up after RECEIVE_TIMEOUT without data or when the client goes away
+bool OtaUpdater::readExact(WiFiClient& client, uint8_t* buffer, size_t length, uint32_t written, uint32_t total, ProgressFunction progress) {
+    size_t received = 0;
+    unsigned long lastData = millis();
+    while (received < length) {
+        int available = client.available();
+        if (available > 0) {
+            int count = client.read(buffer + received, length - received);
+            if (count > 0) {
+                received += count;
+                lastData = millis();
+            }
+        } else if (!client.connected()) {
+            return fail("Disconnected");
+        } else if (millis() - lastData > RECEIVE_TIMEOUT) {
+            return fail("Timeout");
+        } else {
+            delay(1);  // Let the network stack run
+        }
+        if (progress) {
+            progress(written, total);
+        }
+    }
+    return true;
+}
+
+bool OtaUpdater::fail(const char* error) {
+    _error = error;
+    return false;
+}
+
+uint32_t OtaUpdater::getU32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
@@ -0,0 +1,62 @@
+#include "PositionStore.h"
+#include <esp_system.h>
+
+namespace {
+    const uint32_t RECORD_MAGIC = 0x534B4D46;  // "SKMF"
+
+    struct PositionRecord {
+        uint32_t magic;
+        int32_t position;
+        uint32_t check;
+    };
+
+    // Not cleared by a software reset, panic, watchdog or OTA reboot; garbage after power-on
+    RTC_NOINIT_ATTR PositionRecord rtcRecord;
+
+    uint32_t recordCheck(int32_t position) {
+        return RECORD_MAGIC ^ static_cast<uint32_t>(position) ^ 0xFFFFFFFF;
+    }
+}
+
+PositionStore::PositionStore() : _valid(false), _position(0) {}
+
+void PositionStore::begin() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool warmRestart = reason == ESP_RST_SW || reason == ESP_RST_PANIC ||
+                       reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                       reason == ESP_RST_WDT;
+
+    _valid = warmRestart && rtcRecord.magic == RECORD_MAGIC &&
+             rtcRecord.check == recordCheck(rtcRecord.position);
+    _position = _valid ? rtcRecord.position : 0;
+
+    #ifdef DEBUG
+    Serial.print("Stored position ");
+    if (_valid) {
+        Serial.println(_position);
+    } else {
+        Serial.println("not available");
+    }
+    #endif
+}
+
+bool PositionStore::hasValidPosition() const {
+    return _valid;
+}
+
+long PositionStore::getPosition() const {
+    return _position;
+}
+
+void PositionStore::save(long position) {
+    _position = position;
+    _valid = true;
+    rtcRecord.position = position;
+    rtcRecord.check = recordCheck(position);
+    rtcRecord.magic = RECORD_MAGIC;
+}
+
+void PositionStore::invalidate() {
+    _valid = false;
+    rtcRecord.magic = 0;
+}
@@ -0,0 +1,65 @@
+#include "PowerPolicy.h"
+
+PowerPolicy::PowerPolicy()
+    : _reduceDelay(2000), _sleepDelay(30000), _stepperTimeout(60000), _state(0), _lastActivity(0), _lastWake(0),
+      _cpuMhz(FULL_CPU_MHZ), _lightSleep(false), _radioLowPower(false), _stepperIdle(false) {
+    for (uint8_t i = 0; i < MAX_STATES; i++) {
+        _profiles[i] = PROFILE_FULL;
+    }
+}
+
+void PowerPolicy::setProfile(uint8_t state, Profile profile) {
+    if (state < MAX_STATES) {
+        _profiles[state] = profile;
+    }
+}
+
+// All delays in milliseconds since the last input or state change
+void PowerPolicy::setTimeouts(unsigned long reduceDelay, unsigned long sleepDelay, unsigned long stepperTimeout) {
+    _reduceDelay = reduceDelay;
+    _sleepDelay = sleepDelay;
+    _stepperTimeout = stepperTimeout;
+}
+
+// Once per loop pass. Input or a state change restores full power in the same pass.
+void PowerPolicy::update(uint8_t state, bool inputActive, bool clientConnected, unsigned long now) {
+    if (inputActive || state != _state) {
+        _lastActivity = now;
+        _state = state;
+    }
+
+    Profile profile = state < MAX_STATES ? _profiles[state] : PROFILE_FULL;
+    unsigned long idleTime = now - _lastActivity;
+
+    _cpuMhz = profile != PROFILE_FULL && idleTime >= _reduceDelay ? REDUCED_CPU_MHZ : FULL_CPU_MHZ;
+    _stepperIdle = profile != PROFILE_FULL && idleTime >= _stepperTimeout;
+    _lightSleep = profile == PROFILE_SLEEP && !clientConnected && idleTime >= _sleepDelay &&
+                  now - _lastWake >= AWAKE_WINDOW;
+    _radioLowPower = !clientConnected;
+}
+
+// Called after each light sleep, starts the next awake window
+void PowerPolicy::recordWake(unsigned long now) {
+    _lastWake = now;
+    _lightSleep = false;
+}
+
+uint32_t PowerPolicy::getCpuMhz() const {
+    return _cpuMhz;
+}
+
+bool PowerPolicy::allowsLightSleep() const {
+    return _lightSleep;
+}
+
+bool PowerPolicy::isRadioLowPower() const {
+    return _radioLowPower;
+}
+
+bool PowerPolicy::isStepperIdle() const {
+    return _stepperIdle;
+}
+
+unsigned long PowerPolicy::getIdleTime(unsigned long now) const {
+    return now - _lastActivity;
+}
@@ -0,0 +1,248 @@
+#include "RemoteControl.h"
+#include <MD5Builder.h>
+#include "esp_system.h"
+
+RemoteControl::RemoteControl() : _started(false), _queueHead(0), _queueCount(0), _dropped(0), _session(0), _counter(0) {}
+
+// The password keys the tags of signed requests, as in RFC 2104
+bool RemoteControl::begin(const char* password, uint16_t port) {
+    uint8_t key[HMAC_BLOCK_SIZE] = {};
+    size_t keyLength = strlen(password);
+    if (keyLength > HMAC_BLOCK_SIZE) {
+        MD5Builder hash;
+        hash.begin();
+        hash.add(reinterpret_cast<const uint8_t*>(password), keyLength);
+        hash.calculate();
+        hash.getBytes(key);
+    } else {
+        memcpy(key, password, keyLength);
+    }
+    for (uint8_t i = 0; i < HMAC_BLOCK_SIZE; i++) {
+        _innerPad[i] = key[i] ^ 0x36;
+        _outerPad[i] = key[i] ^ 0x5c;
+    }
+    _session = esp_random();
+    _counter = 0;
+
+    _started = _udp.begin(port) != 0;
+    return _started;
+}
+
+// Reads the packets already received, answers the ones that can not be queued
+void RemoteControl::poll() {
+    if (!_started) return;
+
+    for (uint8_t i = 0; i < MAX_PACKETS_PER_POLL; i++) {
+        int size = _udp.parsePacket();
+        if (size <= 0) return;
+
+        uint8_t data[MAX_PACKET_SIZE];
+        int length = _udp.read(data, sizeof(data));
+        if (length < HEADER_SIZE || data[0] != MAGIC_0 || data[1] != MAGIC_1) continue;  // Not for us
+
+        Request request;
+        Status status = decode(data, length, request);
+        if (size > length) status = STATUS_BAD_REQUEST;  // Longer than any valid request
+        request.address = static_cast<uint32_t>(_udp.remoteIP());
+        request.port = _udp.remotePort();
+
+        if (status == STATUS_OK && requiresAuth(request.command) && !authenticate(data, length)) {
+            // Tells the client what to sign its next attempt with
+            uint8_t payload[8];
+            putU32(&payload[0], _session);
+            putU32(&payload[4], _counter);
+            _dropped++;
+            send(request, STATUS_UNAUTHORIZED, payload, sizeof(payload));
+            continue;
+        }
+        if (status == STATUS_OK && _queueCount == QUEUE_SIZE) {
+            status = STATUS_BUSY;
+        }
+        if (status != STATUS_OK) {
+            _dropped++;
+            reply(request, status);
+            continue;
+        }
+        _queue[(_queueHead + _queueCount) % QUEUE_SIZE] = request;
+        _queueCount++;
+    }
+}
+
+// Oldest request first, false when the queue is empty
+bool RemoteControl::nextRequest(Request& request) {
+    if (_queueCount == 0) return false;
+    request = _queue[_queueHead];
+    _queueHead = (_queueHead + 1) % QUEUE_SIZE;
+    _queueCount--;
+    return true;
+}
+
+void RemoteControl::reply(const Request& request, Status status) {
+    send(request, status, NULL, 0);
+}
+
+void RemoteControl::replyValue(const Request& request, Status status, int32_t value) {
+    uint8_t payload[4];
+    putU32(payload, value);
+    send(request, status, payload, sizeof(payload));
+}
+
+// Payload: state, flags (bit 0 heater on), remaining cook time in ms, position in steps
+void RemoteControl::replyStatus(const Request& request, uint8_t state, bool heaterOn, uint32_t remainingTime, int32_t position) {
+    uint8_t payload[10];
+    payload[0] = state;
+    payload[1] = heaterOn ? 0x01 : 0x00;
+    putU32(&payload[2], remainingTime);
+    putU32(&payload[6], position);
+    send(request, STATUS_OK, payload, sizeof(payload));
+}
+
+// Payload: cook time in ms, total distance in micrometres, speed in steps per second
+void RemoteControl::replySettings(const Request& request, uint32_t cookTime, int32_t totalDistance, int32_t speed) {
+    uint8_t payload[12];
+    putU32(&payload[0], cookTime);
+    putU32(&payload[4], totalDistance);
+    putU32(&payload[8], speed);
+    send(request, STATUS_OK, payload, sizeof(payload));
+}
+
+// Payload: records in the log, then the requested record unless the index is past the end
+void RemoteControl::replyLogRecord(const Request& request, uint32_t recordCount, const uint8_t* record, size_t length) {
+    uint8_t payload[MAX_PACKET_SIZE - HEADER_SIZE - 1];
+    putU32(payload, recordCount);
+    if (record == NULL || length > sizeof(payload) - 4) {
+        length = 0;
+    }
+    if (length > 0) {
+        memcpy(&payload[4], record, length);
+    }
+    send(request, STATUS_OK, payload, 4 + length);
+}
+
+uint32_t RemoteControl::getDroppedCount() const {
+    return _dropped;
+}
+
+uint32_t RemoteControl::getSession() const {
+    return _session;
+}
+
+// Appends the counter and tag to a request the way a client signs it, for the
+// host benchmark; packet needs room for AUTH_SIZE more bytes. Returns the new length.
+size_t RemoteControl::sign(uint8_t* packet, size_t length, uint32_t counter) const {
+    putU32(&packet[length], counter);
+    tag(packet, length + 4, &packet[length + 4]);
+    return length + AUTH_SIZE;
+}
+
+// Commands that move a carriage, change what the next cook does or stop the machine for an update
+bool RemoteControl::requiresAuth(uint8_t command) {
+    return command == CMD_START || command == CMD_PARK || command == CMD_SET_SETTING || command == CMD_OTA_MODE;
+}
+
+// Checks the command and payload length, the caller has checked the magic bytes
+RemoteControl::Status RemoteControl::decode(const uint8_t* data, size_t length, Request& request) {
+    request.command = length >= HEADER_SIZE ? data[2] : 0;
+    request.sequence = length >= HEADER_SIZE ? data[3] : 0;
+    request.setting = 0;
+    request.value = 0;
+    if (length < HEADER_SIZE || data[0] != MAGIC_0 || data[1] != MAGIC_1) return STATUS_BAD_REQUEST;
+
+    size_t payloadLength = length - HEADER_SIZE;
+    switch (request.command) {
+        case CMD_START:
+        case CMD_PARK:
+        case CMD_OTA_MODE:
+            return payloadLength == 0 || payloadLength == AUTH_SIZE ? STATUS_OK : STATUS_BAD_REQUEST;
+        case CMD_ABORT:
+        case CMD_GET_STATUS:
+        case CMD_GET_SETTINGS:
+        case CMD_EXPORT_TRACE:
+            return payloadLength == 0 ? STATUS_OK : STATUS_BAD_REQUEST;
+        case CMD_SET_SETTING:
+            if (payloadLength != 5 && payloadLength != 5 + AUTH_SIZE) return STATUS_BAD_REQUEST;
+            request.setting = data[HEADER_SIZE];
+            request.value = static_cast<int32_t>(getU32(&data[HEADER_SIZE + 1]));
+            return request.setting <= SETTING_SPEED ? STATUS_OK : STATUS_BAD_REQUEST;
+        case CMD_READ_LOG:
+            if (payloadLength != 4) return STATUS_BAD_REQUEST;
+            request.value = static_cast<int32_t>(getU32(&data[HEADER_SIZE]));
+            return STATUS_OK;
+        default:
+            return STATUS_BAD_REQUEST;
+    }
+}
+
+// Writes the reply into out, which needs room for MAX_PACKET_SIZE bytes; returns its length
+size_t RemoteControl::encodeReply(const Request& request, Status status, const uint8_t* payload, size_t payloadLength, uint8_t* out) {
+    if (payloadLength > MAX_PACKET_SIZE - HEADER_SIZE - 1) {
+        payloadLength = MAX_PACKET_SIZE - HEADER_SIZE - 1;
+    }
+    out[0] = MAGIC_0;
+    out[1] = MAGIC_1;
+    out[2] = request.command | REPLY_FLAG;
+    out[3] = request.sequence;
+    out[4] = status;
+    if (payloadLength > 0) {
+        memcpy(&out[HEADER_SIZE + 1], payload, payloadLength);
+    }
+    return HEADER_SIZE + 1 + payloadLength;
+}
+
+// True for a request that ends in a valid tag and a counter past the last accepted one, which it then becomes
+bool RemoteControl::authenticate(const uint8_t* data, size_t length) {
+    if (length < HEADER_SIZE + AUTH_SIZE) return false;  // Unsigned
+    uint32_t counter = getU32(&data[length - AUTH_SIZE]);
+    if (counter <= _counter) return false;
+
+    uint8_t expected[TAG_SIZE];
+    tag(data, length - TAG_SIZE, expected);
+    uint8_t difference = 0;  // Compares every byte, so the time taken tells nothing about the tag
+    for (uint8_t i = 0; i < TAG_SIZE; i++) {
+        difference |= expected[i] ^ data[length - TAG_SIZE + i];
+    }
+    if (difference != 0) return false;
+    _counter = counter;
+    return true;
+}
+
+// HMAC-MD5 over the session number and the message
+void RemoteControl::tag(const uint8_t* message, size_t length, uint8_t* out) const {
+    uint8_t session[4];
+    putU32(session, _session);
+    MD5Builder inner;
+    inner.begin();
+    inner.add(_innerPad, sizeof(_innerPad));
+    inner.add(session, sizeof(session));
+    inner.add(message, length);
+    inner.calculate();
+    uint8_t innerHash[TAG_SIZE];
+    inner.getBytes(innerHash);
+
+    MD5Builder outer;
+    outer.begin();
+    outer.add(_outerPad, sizeof(_outerPad));
+    outer.add(innerHash, sizeof(innerHash));
+    outer.calculate();
+    outer.getBytes(out);
+}
+
+void RemoteControl::send(const Request& request, Status status, const uint8_t* payload, size_t payloadLength) {
+    uint8_t packet[MAX_PACKET_SIZE];
+    size_t length = encodeReply(request, status, payload, payloadLength, packet);
+    if (_udp.beginPacket(IPAddress(request.address), request.port)) {
+        _udp.write(packet, length);
+        _udp.endPacket();
+    }
+}
+
+void RemoteControl::putU32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+uint32_t RemoteControl::getU32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
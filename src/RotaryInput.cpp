@@ -0,0 +1,60 @@
+#include "RotaryInput.h"
+
+RotaryInput::RotaryInput()
+    : _encoder(true, onEncoderEvent, this), _events(0), _seenEvents(0), _consumedCount(0), _lastDetentTime(0) {}
+
+void RotaryInput::begin(uint8_t clkPin, uint8_t dtPin) {
+    ESP32Encoder::useInternalWeakPullResistors = UP;
+    _encoder.attachHalfQuad(clkPin, dtPin);
+    _encoder.setCount(0);
+    reset();
+}
+
+void IRAM_ATTR RotaryInput::onEncoderEvent(void* arg) {
+    RotaryInput* input = static_cast<RotaryInput*>(arg);
+    input->_events = input->_events + 1;
+}
+
+int32_t RotaryInput::readDetents() {
+    if (_events == _seenEvents) return 0;
+    // Mark events as seen before reading, so a count change during the read is caught next poll
+    _seenEvents = _events;
+
+    // Whole detents only, a half turned detent stays pending
+    int32_t detents = (_encoder.getCount() - _consumedCount) / COUNTS_PER_DETENT;
+    _consumedCount += detents * COUNTS_PER_DETENT;
+    return detents;
+}
+
+int32_t RotaryInput::readSteps() {
+    return accelerate(readDetents());
+}
+
+// Scales detents just read by the turning speed since the previous movement
+int32_t RotaryInput::accelerate(int32_t detents) {
+    if (detents == 0) return 0;
+
+    unsigned long now = millis();
+    unsigned long elapsed = now - _lastDetentTime;
+    _lastDetentTime = now;
+
+    // Turning speed over the gap since the previous movement
+    uint32_t rate = elapsed > 0 ? abs(detents) * 1000UL / elapsed : FAST_RATE;
+    if (rate >= FAST_RATE) return detents * FAST_MULTIPLIER;
+    if (rate >= MEDIUM_RATE) return detents * MEDIUM_MULTIPLIER;
+    return detents;
+}
+
+int64_t RotaryInput::getCount() {
+    return _encoder.getCount();
+}
+
+// Count of encoder interrupts, changes whenever the knob moves
+uint32_t RotaryInput::getEventCount() const {
+    return _events;
+}
+
+void RotaryInput::reset() {
+    _seenEvents = _events;
+    _consumedCount = _encoder.getCount();
+}
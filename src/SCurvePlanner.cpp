@@ -0,0 +1,184 @@
+#include "SCurvePlanner.h"
+
+namespace {
+    uint32_t isqrt64(uint64_t value) {
+        uint64_t result = 0;
+        uint64_t bit = 1ULL << 62;
+        while (bit > value) bit >>= 2;
+        while (bit != 0) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return static_cast<uint32_t>(result);
+    }
+}
+
+SCurvePlanner::SCurvePlanner()
+    : _maxSpeed(1000 << FRACTION_BITS), _acceleration(5000 << FRACTION_BITS), _jerk(100000),
+      _startSpeed(200 << FRACTION_BITS), _position(0), _target(0), _frame(1), _velocity(0), _accel(0),
+      _braking(false), _moving(false) {}
+
+void SCurvePlanner::setMaxSpeed(uint32_t speed) {
+    _maxSpeed = speed << FRACTION_BITS;
+}
+
+void SCurvePlanner::setAcceleration(uint32_t acceleration) {
+    _acceleration = acceleration << FRACTION_BITS;
+}
+
+void SCurvePlanner::setJerk(uint32_t jerk) {
+    _jerk = jerk > 0 ? jerk : 1;
+}
+
+void SCurvePlanner::setStartSpeed(uint32_t speed) {
+    _startSpeed = (speed > 0 ? speed : 1) << FRACTION_BITS;
+}
+
+void SCurvePlanner::setPosition(int32_t position) {
+    _position = position;
+    _target = position;
+    _velocity = 0;
+    _accel = 0;
+    _braking = false;
+    _moving = false;
+}
+
+void SCurvePlanner::setTarget(int32_t target) {
+    _target = target;
+    _braking = false;  // Re-evaluated on the next step
+    _moving = _moving || target != _position;
+}
+
+void SCurvePlanner::stop() {
+    if (!_moving) return;
+    // Target the point where the current motion comes to rest
+    int8_t motion = _velocity >= 0 ? _frame : -_frame;
+    setTarget(_position + motion * static_cast<int32_t>(getStoppingDistance()));
+}
+
+uint32_t SCurvePlanner::getStoppingDistance() const {
+    int64_t velocity = _velocity < 0 ? -static_cast<int64_t>(_velocity) : _velocity;
+    int64_t jerk = _jerk;
+    int64_t rampDistance = 0;
+    if (_velocity > 0 && _accel > 0) {
+        // Distance and speed still gained while the acceleration is ramped down to zero
+        int64_t accel = _accel >> FRACTION_BITS;
+        rampDistance = ((velocity >> FRACTION_BITS) * accel + accel * accel * accel / (3 * jerk)) / jerk;
+        velocity += (static_cast<int64_t>(_accel) * _accel / (2 * jerk)) >> FRACTION_BITS;
+    }
+    int64_t speed = velocity >> FRACTION_BITS;
+    if (speed <= 0) return 0;
+
+    int64_t acceleration = _acceleration >> FRACTION_BITS;
+    // Symmetric S-curve from speed to rest, starting and ending at zero acceleration
+    if (speed * jerk >= acceleration * acceleration) {
+        return static_cast<uint32_t>(rampDistance + (speed * speed / acceleration + speed * acceleration / jerk) / 2) + 1;
+    }
+    return static_cast<uint32_t>(rampDistance) + isqrt64(static_cast<uint64_t>(speed * speed * speed / jerk)) + 1;
+}
+
+uint32_t SCurvePlanner::nextStep(int8_t& direction) {
+    if (!_moving) return 0;
+
+    int32_t remaining = (_target - _position) * _frame;
+    if (remaining < 0) {
+        // Target now lies behind: the same motion, seen from the other side
+        _frame = -_frame;
+        remaining = -remaining;
+        _velocity = -_velocity;
+        _accel = -_accel;
+        _braking = false;
+        if (_velocity >= -static_cast<int32_t>(_startSpeed)) {
+            // Slow enough to reverse on the spot
+            _velocity = 0;
+            _accel = 0;
+        }
+    }
+
+    if (remaining == 0 && _velocity <= static_cast<int32_t>(_startSpeed) && _velocity >= -static_cast<int32_t>(_startSpeed)) {
+        _velocity = 0;
+        _accel = 0;
+        _braking = false;
+        _moving = false;
+        return 0;
+    }
+
+    if (!_braking && _velocity > 0 && static_cast<uint32_t>(remaining) <= getStoppingDistance()) {
+        _braking = true;
+    }
+
+    int32_t targetAccel;
+    int32_t maxAccel = static_cast<int32_t>(_acceleration);
+    if (_braking) {
+        // Full deceleration, then ramp out so speed and acceleration reach zero together
+        int64_t rampOutSpeed = _accel < 0 ? (static_cast<int64_t>(_accel) * _accel / (2 * static_cast<int64_t>(_jerk))) >> FRACTION_BITS : 0;
+        targetAccel = _velocity <= rampOutSpeed ? 0 : -maxAccel;
+    } else if (_velocity > static_cast<int32_t>(_maxSpeed)) {
+        targetAccel = -maxAccel;  // Max speed was lowered while moving
+    } else if (static_cast<int64_t>(_maxSpeed) - _velocity <= (static_cast<int64_t>(_accel) * _accel / (2 * static_cast<int64_t>(_jerk)) >> FRACTION_BITS)) {
+        targetAccel = 0;  // Ramp the acceleration down to arrive at max speed
+    } else {
+        targetAccel = maxAccel;
+    }
+
+    int64_t speed = _velocity < 0 ? -static_cast<int64_t>(_velocity) : _velocity;
+    int64_t startSpeed = _startSpeed;
+    int8_t motion = (_velocity > 0 || (_velocity == 0 && targetAccel >= 0)) ? 1 : -1;
+
+    // Jerk-limited change of acceleration over the time of this step
+    uint64_t stepTime = (static_cast<uint64_t>(MICROS_PER_SECOND) << FRACTION_BITS) / (speed > startSpeed ? speed : startSpeed);
+    int64_t maxAccelChange = (static_cast<int64_t>(_jerk) * stepTime << FRACTION_BITS) / MICROS_PER_SECOND;
+    int64_t accelChange = static_cast<int64_t>(targetAccel) - _accel;
+    if (accelChange > maxAccelChange) accelChange = maxAccelChange;
+    if (accelChange < -maxAccelChange) accelChange = -maxAccelChange;
+    _accel += static_cast<int32_t>(accelChange);
+
+    // Exact kinematics over one step (v^2 = v0^2 + 2a), so long decelerations don't drift off target
+    int64_t speedSquared = speed * speed + 2 * static_cast<int64_t>(motion * _accel) * (1 << FRACTION_BITS);
+    int64_t newSpeed = speedSquared > 0 ? isqrt64(static_cast<uint64_t>(speedSquared)) : 0;
+    int64_t averageSpeed = (speed + newSpeed) / 2;
+    if (averageSpeed < startSpeed) averageSpeed = startSpeed;
+    uint32_t interval = static_cast<uint32_t>((static_cast<uint64_t>(MICROS_PER_SECOND) << FRACTION_BITS) / averageSpeed);
+
+    int32_t previousVelocity = _velocity;
+    _velocity = motion * static_cast<int32_t>(newSpeed);
+    if (!_braking && previousVelocity <= static_cast<int32_t>(_maxSpeed) && _velocity > static_cast<int32_t>(_maxSpeed)) {
+        _velocity = _maxSpeed;
+    }
+    if (_braking && remaining > 0 && _velocity < static_cast<int32_t>(_startSpeed)) {
+        _velocity = _startSpeed;  // Creep the last steps in at the start speed
+    }
+
+    direction = motion * _frame;
+    _position += direction;
+    return interval;
+}
+
+int32_t SCurvePlanner::getPosition() const {
+    return _position;
+}
+
+int32_t SCurvePlanner::getTarget() const {
+    return _target;
+}
+
+int32_t SCurvePlanner::getSpeed() const {
+    return (_velocity >> FRACTION_BITS) * _frame;
+}
+
+uint32_t SCurvePlanner::getMaxSpeed() const {
+    return _maxSpeed >> FRACTION_BITS;
+}
+
+bool SCurvePlanner::isMoving() const {
+    return _moving;
+}
+
+bool SCurvePlanner::isBraking() const {
+    return _braking;
+}
@@ -0,0 +1,108 @@
+#include "SerialConsole.h"
+
+SerialConsole::SerialConsole()
+    : _commandCount(0), _stream(NULL), _lineLength(0), _lineTooLong(false), _outputHead(0), _outputCount(0),
+      _droppedBytes(0) {}
+
+bool SerialConsole::addCommand(const char* name, const char* help, CommandFunction function) {
+    if (_commandCount >= MAX_COMMANDS || function == NULL) return false;
+    Command& command = _commands[_commandCount++];
+    command.name = name;
+    command.help = help;
+    command.function = function;
+    return true;
+}
+
+// The port has to be started already
+void SerialConsole::begin(Stream& stream) {
+    _stream = &stream;
+}
+
+// Reads at most one line's worth of what has arrived, so a paste costs no more than a typed command
+void SerialConsole::poll(unsigned long currentTime) {
+    if (_stream == NULL) return;
+    for (size_t i = 0; i <= MAX_LINE_LENGTH && _stream->available() > 0; i++) {
+        char c = _stream->read();
+        if (c == '\r' || c == '\n') {
+            if (_lineTooLong) {
+                println("Line too long");
+            } else if (_lineLength > 0) {
+                _line[_lineLength] = '\0';
+                execute(currentTime);
+            }
+            _lineLength = 0;
+            _lineTooLong = false;
+            return;  // One command per poll, the rest waits in the receive buffer
+        }
+        if (_lineLength < MAX_LINE_LENGTH) {
+            _line[_lineLength++] = c;
+        } else {
+            _lineTooLong = true;
+        }
+    }
+}
+
+// Splits off the command name and hands the rest of the line to its function
+void SerialConsole::execute(unsigned long currentTime) {
+    char* name = _line;
+    while (*name == ' ') name++;
+    char* args = name;
+    while (*args != '\0' && *args != ' ') args++;
+    if (*args != '\0') {
+        *args++ = '\0';
+        while (*args == ' ') args++;
+    }
+    if (*name == '\0') return;
+
+    for (uint8_t i = 0; i < _commandCount; i++) {
+        if (strcmp(name, _commands[i].name) == 0) {
+            _commands[i].function(*this, args, currentTime);
+            return;
+        }
+    }
+    printf("Unknown command '%s', try help\n", name);
+}
+
+// Sends up to room bytes of buffered output, room being what the port takes without blocking
+void SerialConsole::drain(size_t room) {
+    if (_stream == NULL) return;
+    while (_outputCount > 0 && room > 0) {
+        // The pending bytes may wrap around the end of the buffer
+        size_t length = OUTPUT_BUFFER_SIZE - _outputHead;
+        if (length > _outputCount) length = _outputCount;
+        if (length > room) length = room;
+        _stream->write(_output + _outputHead, length);
+        _outputHead = (_outputHead + length) % OUTPUT_BUFFER_SIZE;
+        _outputCount -= length;
+        room -= length;
+    }
+}
+
+bool SerialConsole::hasOutput() const {
+    return _outputCount > 0;
+}
+
+uint32_t SerialConsole::getDroppedBytes() const {
+    return _droppedBytes;
+}
+
+void SerialConsole::printHelp(Print& out) const {
+    for (uint8_t i = 0; i < _commandCount; i++) {
+        out.printf("  %-10s %s\n", _commands[i].name, _commands[i].help);
+    }
+}
+
+size_t SerialConsole::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+// Buffers what fits, the rest is dropped so a command never waits for the port
+size_t SerialConsole::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && _outputCount < OUTPUT_BUFFER_SIZE) {
+        _output[(_outputHead + _outputCount) % OUTPUT_BUFFER_SIZE] = buffer[written++];
+        _outputCount++;
+    }
+    _droppedBytes += size - written;
+    return written;
+}
@@ -1,18 +1,22 @@
 #include "Settings.h"
 #include <Preferences.h>
+#include <limits.h>
 
-extern ButtonHandler buttonRotarySwitch;
+using SettingsSchema::FIELDS;
 
-// Define speed constants
-const float SPEED_MIN = 500.0f;
-const float SPEED_MAX = 3500.0f;
+// Storage for the action table, still required before C++17
+constexpr Settings::ActionInfo Settings::ACTIONS[];
 
-Settings::Settings(MatrixDisplay& display, ESP32Encoder& encoder)
-    : _display(display), _encoder(encoder), _isDone(false), _inEditMode(false), _currentMenuIndex(0), _lastEncoderValue(0),
-      _totalSteps(0), _settingsChanged(false) {
-    initializeMenuItems();
-    // loadSettingsFromPreferences();
-    _totalSteps = (_totalDistance / DISTANCE_PER_REV) * STEPS_PER_REV;
+Settings::Settings(MatrixDisplay& display, RotaryInput& rotary)
+    : _totalSteps(), _display(display), _rotary(rotary), _isDone(false), _inEditMode(false), _confirming(false),
+      _confirmed(false), _confirmAction(Action::EXIT), _confirmMessage(""), _currentMenuIndex(0), _showingMessage(false),
+      _exitAfterMessage(false), _messageStart(0), _messageDuration(0), _settingsChanged(false), _renderPending(false), _lastRenderTime(0), _renderedIndex(SIZE_MAX), _renderedKey(0) {
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        _valueTexts[i].key = LONG_MIN;
+        _valueTexts[i].text[0] = '\0';
+        setValue(i, FIELDS[i].defaultValue);
+    }
+    markStored();
 }
 
 Settings::~Settings() {
@@ -23,86 +27,116 @@ void Settings::loadSettingsFromPreferences() {
     Preferences preferences;
     preferences.begin("settings", false);
 
-    _cookTime = preferences.getULong("cookTime", 30000);
-    _totalDistance = preferences.getFloat("totalDistance", 50.0f);
-    _speed = preferences.getFloat("speed", (SPEED_MIN + SPEED_MAX) / 2);
-
-    // Validate loaded values and set defaults if necessary
-    _cookTime = (_cookTime >= 5000 && _cookTime <= 120000) ? _cookTime : 30000;
-    _totalDistance = (_totalDistance >= 50.0f && _totalDistance <= 120.0f) ? _totalDistance : 50.0f;
-    _speed = (_speed >= SPEED_MIN && _speed <= SPEED_MAX) ? _speed : (SPEED_MIN + SPEED_MAX) / 2;
+    // A stored value outside its range falls back to the default
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        const SettingField& field = FIELDS[i];
+        float value;
+        if (field.storage == SettingField::STORE_ULONG) {
+            value = preferences.getULong(field.key, static_cast<unsigned long>(field.defaultValue));
+        } else {
+            value = preferences.getFloat(field.key, field.defaultValue);
+        }
+        setValue(i, field.contains(value) ? value : field.defaultValue);
+    }
 
     preferences.end();
-
-    // Recalculate _totalSteps
-    _totalSteps = (_totalDistance / DISTANCE_PER_REV) * STEPS_PER_REV;
-
-    _initialCookTime = _cookTime;
-    _initialTotalDistance = _totalDistance;
-    _initialSpeed = _speed;
-    _settingsChanged = false;
-    updateMenuVisibility();
+    markStored();
 }
 
 void Settings::saveSettingsToPreferences() {
     Preferences preferences;
     preferences.begin("settings", false);
 
-    preferences.putULong("cookTime", _cookTime);
-    preferences.putFloat("totalDistance", _totalDistance);
-    preferences.putFloat("speed", _speed);
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        const SettingField& field = FIELDS[i];
+        if (field.storage == SettingField::STORE_ULONG) {
+            preferences.putULong(field.key, static_cast<unsigned long>(lroundf(_values[i])));
+        } else {
+            preferences.putFloat(field.key, _values[i]);
+        }
+    }
 
     preferences.end();
+    markStored();
+}
 
-    _initialCookTime = _cookTime;
-    _initialTotalDistance = _totalDistance;
-    _initialSpeed = _speed;
-    _settingsChanged = false;
-    updateMenuVisibility();
+Millis Settings::getCookTime() const { return Millis(static_cast<uint32_t>(_values[SettingsSchema::COOK_TIME])); }
+Millimetres Settings::getTotalDistance() const { return Millimetres(_values[SettingsSchema::TOTAL_DISTANCE]); }
+StepsPerSecond Settings::getSpeed() const { return StepsPerSecond(_values[SettingsSchema::MAX_SPEED]); }
+Steps Settings::getTotalSteps() const { return _totalSteps; }
+
+// Setters clamp to the same limits as menu editing
+void Settings::setCookTime(Millis cookTime) {
+    setValue(SettingsSchema::COOK_TIME, cookTime.value());
 }
 
-unsigned long Settings::getCookTime() const { return _cookTime; }
-float Settings::getTotalDistance() const { return _totalDistance; }
-float Settings::getSpeed() const { return _speed; }
-int Settings::getTotalSteps() const { return _totalSteps; }
+void Settings::setTotalDistance(Millimetres totalDistance) {
+    setValue(SettingsSchema::TOTAL_DISTANCE, totalDistance.value());
+}
+
+void Settings::setSpeed(StepsPerSecond speed) {
+    setValue(SettingsSchema::MAX_SPEED, speed.value());
+}
+
+// The one place a value changes, clamped to its field's range
+void Settings::setValue(size_t id, float value) {
+    _values[id] = FIELDS[id].clamp(value);
+    if (id == SettingsSchema::TOTAL_DISTANCE) {
+        _totalSteps = Drive::toSteps(Millimetres(_values[id]));
+    }
+}
+
+// The current values are what NVS holds
+void Settings::markStored() {
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        _storedValues[i] = _values[i];
+    }
+    updateMenuVisibility();
+}
 
 void Settings::factoryReset() {
-    _cookTime = 30000;
-    _totalDistance = 50.0f;
-    _speed = (SPEED_MIN + SPEED_MAX) / 2;
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        setValue(i, FIELDS[i].defaultValue);
+    }
     saveSettingsToPreferences();
-    updateDisplay();
-    _settingsChanged = false;
-    updateMenuVisibility();
 }
 
 void Settings::enter() {
     _isDone = false;
     _inEditMode = false;
+    _confirming = false;
+    _showingMessage = false;
     _currentMenuIndex = 0;
-    _lastEncoderValue = _encoder.getCount();
+    _rotary.reset();
     updateMenuVisibility();
+    invalidateRender();
     displayCurrentMenuItem();
 }
 
 void Settings::exit() {
     _isDone = true;
     _inEditMode = false;
+    _confirming = false;
+    _showingMessage = false;
     _currentMenuIndex = 0;  // Reset menu index
-    _lastEncoderValue = _encoder.getCount();  // Reset encoder value
+    _rotary.reset();  // Drop movement made while leaving the menu
 }
 
-void Settings::update() {
-    int8_t direction = getEncoderDirection();
-    if (direction != 0) {
+// Encoder turns and rotary switch presses while the menu is open
+void Settings::handleEvent(const InputEvent& event) {
+    if (_showingMessage) return;  // Input waits for the menu to come back
+    if (_confirming) {
+        handleConfirmEvent(event);
+        return;
+    }
+
+    if (event.type == InputEvent::ENCODER) {
         if (_inEditMode) {
-            adjustValue(direction);
+            adjustValue(event.steps);  // Values follow the turning speed
         } else {
-            handleMenuNavigation(direction);
+            handleMenuNavigation(event.value);
         }
-    }
-    
-    if (buttonRotarySwitch.isPressed()) {
+    } else if (event.type == InputEvent::PRESS && event.source == InputEvent::SOURCE_ROTARY_SWITCH) {
         if (_inEditMode) {
             exitEditMode();
         } else {
@@ -111,153 +145,194 @@ void Settings::update() {
     }
 }
 
-void Settings::handleMenuNavigation(int8_t direction) {
-    do {
-        if (direction > 0) {
-            _currentMenuIndex = (_currentMenuIndex + 1) % _menuItems.size();
+// Draws what the events changed, at most once per frame, unless a question or message is shown
+void Settings::update() {
+    if (_showingMessage) {
+        if (millis() - _messageStart < _messageDuration) return;
+        _showingMessage = false;
+        if (_exitAfterMessage) {
+            exit();
         } else {
-            _currentMenuIndex = (_currentMenuIndex > 0) ? _currentMenuIndex - 1 : _menuItems.size() - 1;
+            returnToMenu();
         }
-    } while (!_menuItems[_currentMenuIndex].visible);
-    displayCurrentMenuItem();
+        return;
+    }
+    if (!_confirming) {
+        flushRender();
+    }
+}
+
+void Settings::handleMenuNavigation(int32_t detents) {
+    // One visible item per detent
+    for (int32_t i = abs(detents); i > 0; i--) {
+        do {
+            if (detents > 0) {
+                _currentMenuIndex = (_currentMenuIndex + 1) % MENU_ITEM_COUNT;
+            } else {
+                _currentMenuIndex = (_currentMenuIndex > 0) ? _currentMenuIndex - 1 : MENU_ITEM_COUNT - 1;
+            }
+        } while (!isVisible(_currentMenuIndex));
+    }
+    requestRender();
 }
 
 void Settings::handleMenuSelection() {
-    switch (_menuItems[_currentMenuIndex].item) {
-        case MenuItem::COOK_TIME:
-        case MenuItem::TOTAL_DISTANCE:
-        case MenuItem::MAX_SPEED:
-            enterEditMode();
-            break;
-        case MenuItem::LOAD_EEPROM:
+    if (_currentMenuIndex < SettingsSchema::COUNT) {
+        enterEditMode();
+        return;
+    }
+    handleAction(ACTIONS[_currentMenuIndex - SettingsSchema::COUNT].action);
+}
+
+void Settings::handleAction(Action action) {
+    switch (action) {
+        case Action::LOAD_EEPROM:
             loadSettingsFromPreferences();
-            _display.updateDisplay("Settings Loaded", "");
-            delay(1000);
-            break;
-        case MenuItem::SAVE_EEPROM:
-            if (confirmAction("Save Settings?")) {
-                saveSettingsToPreferences();
-                _display.updateDisplay("Settings","Saved...");
-                delay(1000);
-                exit();
-            }
-            break;
-        case MenuItem::EXIT:
+            showMessage("Settings Loaded", "", LOADED_MESSAGE_DURATION, false);
+            return;
+        case Action::SAVE_EEPROM:
+            startConfirm(Action::SAVE_EEPROM, "Save Settings?");
+            return;
+        case Action::EXIT:
             exit();
-            break;
-        case MenuItem::FACTORY_RESET:
-            if (confirmAction("Factory Reset?")) {
-                factoryReset();
-                _display.updateDisplay("Factory Reset", "Complete..");
-                delay(2000);
-            }
-            break;
+            return;
+        case Action::FACTORY_RESET:
+            startConfirm(Action::FACTORY_RESET, "Factory Reset?");
+            return;
     }
+}
+
+// Shows a result without holding up the loop, update() takes it down after duration ms
+void Settings::showMessage(const char* row1, const char* row2, unsigned long duration, bool exitAfter) {
+    _display.updateDisplay(row1, row2);
+    _showingMessage = true;
+    _exitAfterMessage = exitAfter;
+    _messageStart = millis();
+    _messageDuration = duration;
+}
+
+void Settings::returnToMenu() {
     updateMenuVisibility();
+    invalidateRender();  // A question or message replaced the menu
     displayCurrentMenuItem();
 }
 
-bool Settings::confirmAction(const char* message) {
+// Asks Yes/No for action, the answer comes in through handleEvent()
+void Settings::startConfirm(Action action, const char* message) {
+    _confirming = true;
+    _confirmed = true;
+    _confirmAction = action;
+    _confirmMessage = message;
     _display.updateDisplay(message, "Yes");
-    
-    bool confirmed = true;
-    int32_t lastConfirmEncoderValue = _encoder.getCount();
-    
-    // Wait for button release
-    while (buttonRotarySwitch.getState()) {
-        buttonRotarySwitch.update();
-        delay(10);
+}
+
+// Any turn toggles the answer, a press of the rotary switch takes it
+void Settings::handleConfirmEvent(const InputEvent& event) {
+    if (event.type == InputEvent::ENCODER) {
+        _confirmed = !_confirmed;
+        _display.updateDisplay(_confirmMessage, _confirmed ? "Yes" : "No");
+    } else if (event.type == InputEvent::PRESS && event.source == InputEvent::SOURCE_ROTARY_SWITCH) {
+        finishConfirm();
     }
-    
-    while (true) {
-        buttonRotarySwitch.update();
-        
-        int32_t newEncoderValue = _encoder.getCount();
-        if (newEncoderValue != lastConfirmEncoderValue) {
-            confirmed = !confirmed;
-            _display.updateDisplay(message, confirmed ? "Yes" : "No");
-            lastConfirmEncoderValue = newEncoderValue;
-        }
-        
-        if (buttonRotarySwitch.isPressed()) {
-            // Wait for button release
-            while (buttonRotarySwitch.getState()) {
-                buttonRotarySwitch.update();
-                delay(10);
-            }
-            return confirmed;
+}
+
+void Settings::finishConfirm() {
+    _confirming = false;
+    if (_confirmed) {
+        if (_confirmAction == Action::SAVE_EEPROM) {
+            saveSettingsToPreferences();
+            showMessage("Settings", "Saved...", SAVED_MESSAGE_DURATION, true);
+            return;
+        } else if (_confirmAction == Action::FACTORY_RESET) {
+            factoryReset();
+            showMessage("Factory Reset", "Complete..", RESET_MESSAGE_DURATION, false);
+            return;
         }
-        
-        delay(10);  // Small delay to prevent excessive CPU usage
     }
+    returnToMenu();
 }
 
 bool Settings::isDone() const {
     return _isDone;
 }
 
-void Settings::initializeMenuItems() {
-    _menuItems = {
-        {MenuItem::COOK_TIME, "Cook Time", true},
-        {MenuItem::TOTAL_DISTANCE, "Total Distance", true},
-        {MenuItem::MAX_SPEED, "Max Speed", true},
-        {MenuItem::LOAD_EEPROM, "Load EEPROM", false},
-        {MenuItem::SAVE_EEPROM, "Save EEPROM", false},
-        {MenuItem::EXIT, "Exit", true},
-        {MenuItem::FACTORY_RESET, "Factory Reset", false}
-    };
-}
-
 void Settings::updateMenuVisibility() {
-    _settingsChanged = (_cookTime != _initialCookTime) ||
-                       (_totalDistance != _initialTotalDistance) ||
-                       (_speed != _initialSpeed);
-
-    for (auto& item : _menuItems) {
-        switch (item.item) {
-            case MenuItem::LOAD_EEPROM:
-            case MenuItem::SAVE_EEPROM:
-            case MenuItem::FACTORY_RESET:
-                item.visible = _settingsChanged;
-                break;
-            default:
-                item.visible = true;
-                break;
+    _settingsChanged = false;
+    for (size_t i = 0; i < SettingsSchema::COUNT; i++) {
+        if (_values[i] != _storedValues[i]) {
+            _settingsChanged = true;
         }
     }
 }
 
+// Settings are always offered, actions per their table entry
+bool Settings::isVisible(size_t menuIndex) const {
+    if (menuIndex < SettingsSchema::COUNT) return true;
+    return _settingsChanged || ACTIONS[menuIndex - SettingsSchema::COUNT].alwaysVisible;
+}
+
+const char* Settings::menuName(size_t menuIndex) const {
+    if (menuIndex < SettingsSchema::COUNT) return FIELDS[menuIndex].name;
+    return ACTIONS[menuIndex - SettingsSchema::COUNT].displayName;
+}
+
 void Settings::displayCurrentMenuItem() {
-    String topLine = _menuItems[_currentMenuIndex].displayName;
-    String bottomLine;
-    
-    switch (_menuItems[_currentMenuIndex].item) {
-        case MenuItem::COOK_TIME:
-            bottomLine = String(_cookTime / 1000) + "s";
-            break;
-        case MenuItem::TOTAL_DISTANCE:
-            bottomLine = String(_totalDistance, 1) + "mm";
-            break;
-        case MenuItem::MAX_SPEED:
-            bottomLine = String(map(_speed, SPEED_MIN, SPEED_MAX, 0, 100)) + "%";
-            break;
-        default:
-            break;
+    bool isSetting = _currentMenuIndex < SettingsSchema::COUNT;
+    long key = isSetting ? valueKey(_currentMenuIndex) : 0;
+    _renderPending = false;
+
+    // Nothing to do if the screen already shows this item and value
+    if (_currentMenuIndex == _renderedIndex && key == _renderedKey) return;
+
+    _display.updateDisplay(menuName(_currentMenuIndex), isSetting ? valueText(_currentMenuIndex) : "");
+    _renderedIndex = _currentMenuIndex;
+    _renderedKey = key;
+    _lastRenderTime = millis();
+}
+
+// Integer form of the displayed value, equal keys give equal text
+long Settings::valueKey(size_t id) const {
+    const SettingField& field = FIELDS[id];
+    float value = _values[id];
+    switch (field.format) {
+        case SettingField::FORMAT_THOUSANDTHS:
+            return static_cast<long>(value) / 1000;
+        case SettingField::FORMAT_TENTHS:
+            return lroundf(value * 10.0f);
+        case SettingField::FORMAT_PERCENT:
+            return lroundf((value - field.min) / (field.max - field.min) * 100.0f);
+    }
+    return 0;
+}
+
+const char* Settings::valueText(size_t id) {
+    const SettingField& field = FIELDS[id];
+    ValueText& cached = _valueTexts[id];
+    long key = valueKey(id);
+    if (cached.key != key) {
+        if (field.format == SettingField::FORMAT_TENTHS) {
+            snprintf(cached.text, sizeof(cached.text), "%d.%d%s", static_cast<int>(key / 10), static_cast<int>(key % 10), field.unit);
+        } else {
+            snprintf(cached.text, sizeof(cached.text), "%ld%s", key, field.unit);
+        }
+        cached.key = key;
     }
-    
-    _display.updateDisplay(topLine, bottomLine);
+    return cached.text;
+}
+
+void Settings::requestRender() {
+    _renderPending = true;
+}
+
+void Settings::invalidateRender() {
+    _renderedIndex = SIZE_MAX;
 }
 
-int8_t Settings::getEncoderDirection() {
-    int32_t newValue = _encoder.getCount();
-    int8_t direction = 0;
-    if (newValue > _lastEncoderValue) {
-        direction = 1;
-    } else if (newValue < _lastEncoderValue) {
-        direction = -1;
+// Draws a pending change once the frame interval has passed, so a burst of detents gives one update
+void Settings::flushRender() {
+    if (_renderPending && millis() - _lastRenderTime >= RENDER_INTERVAL) {
+        displayCurrentMenuItem();
     }
-    _lastEncoderValue = newValue;
-    return direction;
 }
 
 void Settings::enterEditMode() {
@@ -272,60 +347,10 @@ void Settings::exitEditMode() {
     displayCurrentMenuItem();
 }
 
-void Settings::adjustValue(int8_t direction) {
-    switch (_menuItems[_currentMenuIndex].item) {
-        case MenuItem::COOK_TIME:
-            adjustCookTime(direction);
-            break;
-        case MenuItem::TOTAL_DISTANCE:
-            adjustTotalDistance(direction);
-            break;
-        case MenuItem::MAX_SPEED:
-            adjustMaxSpeed(direction);
-            break;
-        default:
-            break;
-    }
-    updateDisplay();
-    updateMenuVisibility();
-}
-
-void Settings::adjustCookTime(int8_t direction) {
-    _cookTime += direction * 1000; // Adjust by 1 second
-    if (_cookTime < 5000) _cookTime = 5000; // Minimum 5 seconds
-    if (_cookTime > 120000) _cookTime = 120000; // Maximum 120 seconds
-}
-
-void Settings::adjustTotalDistance(int8_t direction) {
-    _totalDistance += direction * 5.0f; // Adjust by 5mm
-    if (_totalDistance < 50.0f) _totalDistance = 50.0f; // Minimum 50mm
-    if (_totalDistance > 120.0f) _totalDistance = 120.0f; // Maximum 120mm
-    
-    // Recalculate TOTAL_STEPS
-    _totalSteps = (_totalDistance / DISTANCE_PER_REV) * STEPS_PER_REV;
-}
-
-void Settings::adjustMaxSpeed(int8_t direction) {
-    float step = (SPEED_MAX - SPEED_MIN) / 100.0f; // Adjust by 1% of the speed range
-    _speed += direction * step;
-    _speed = constrain(_speed, SPEED_MIN, SPEED_MAX);
-}
-
-void Settings::updateDisplay() {
-    String value;
-    switch (_menuItems[_currentMenuIndex].item) {
-        case MenuItem::COOK_TIME:
-            value = String(_cookTime / 1000) + "s";
-            break;
-        case MenuItem::TOTAL_DISTANCE:
-            value = String(_totalDistance, 1) + "mm";
-            break;
-        case MenuItem::MAX_SPEED:
-            value = String(((_speed - SPEED_MIN) / (SPEED_MAX - SPEED_MIN) * 100), 0) + "%";
-            break;
-        default:
-            value = "";
-            break;
-    }
-    _display.updateDisplay(_menuItems[_currentMenuIndex].displayName, value);
+// One schema step per encoder step, clamped like any other write
+void Settings::adjustValue(int32_t steps) {
+    if (_currentMenuIndex >= SettingsSchema::COUNT) return;
+    setValue(_currentMenuIndex, _values[_currentMenuIndex] + steps * FIELDS[_currentMenuIndex].step);
+    // Visibility only changes what navigation offers, it is refreshed on leaving edit mode
+    requestRender();
 }
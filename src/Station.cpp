@@ -0,0 +1,822 @@
+#include "Station.h"
+
+// Define direction constants
+#define DIRECTION_HOME 1
+#define DIRECTION_RUN 1
+
+constexpr Millimetres HOMING_DISTANCE(125.0f);  // Distance from the switch trigger point to the zero position
+constexpr Millimetres HOMING_BACKOFF_DISTANCE(3.0f);  // Distance to back off before the slow re-approach
+constexpr Millimetres HOMING_TOLERANCE(2.0f);  // Extra travel allowed past the expected switch position
+constexpr Millimetres PARK_DISTANCE(120.0f);  // Parking position, clear of the heater
+
+// Homing geometry in steps, converted at compile time
+constexpr Steps HOMING_SWITCH_POSITION = Drive::toSteps(HOMING_DISTANCE) * DIRECTION_HOME;
+constexpr Steps HOMING_BACKOFF_STEPS = Drive::toSteps(HOMING_BACKOFF_DISTANCE);
+constexpr Steps HOMING_SEARCH_STEPS = Drive::toSteps(HOMING_BACKOFF_DISTANCE + HOMING_TOLERANCE);
+
+#define HOMING_FAST_SPEED 2500.0 // Speed for the fast approach towards the switch
+#define HOMING_SLOW_SPEED 400.0 // Speed for the precise re-approach, slow enough to stop on the spot
+#define MOVE_TO_ZERO_SPEED 3000.0 // Speed for moving to zero position after homing
+
+const float ACCELERATION = 5000.0;  // Adjust for smooth acceleration
+const float JERK = 100000.0;  // Jerk limit, keeps the S-curve moves free of skipped steps (steps/s^3)
+const float STROKE_JERK = 100000.0;  // Jerk limit for the cooking strokes (steps/s^3)
+const Millis STROKE_DWELL(0);  // Optional standstill at each end of a stroke
+
+const unsigned long WELCOME_DURATION = 300;  // 0.3 seconds
+const unsigned long HOMING_TIMEOUT = 30000;   // 30 seconds
+const unsigned long LCD_UPDATE_INTERVAL = 250;  // 0.25 second in milliseconds
+// Screens redrawn field by field while the carriage moves
+constexpr LcdLayout::Field RUNNING_FIELDS[] = {
+    {LcdLayout::FIELD_NUMBER, 0, 5, 4, 0},  // Remaining cook time in s
+    {LcdLayout::FIELD_BAR, 0, 10, 6, 0},    // Cook progress
+    {LcdLayout::FIELD_NUMBER, 1, 5, 5, 1}   // Carriage position in mm
+};
+constexpr LcdLayout::Screen RUNNING_SCREEN = {"Time:    s", "Dist:     mm", RUNNING_FIELDS, 3};
+constexpr LcdLayout::Field RETURNING_FIELDS[] = {
+    {LcdLayout::FIELD_NUMBER, 1, 5, 5, 1}   // Carriage position in mm
+};
+constexpr LcdLayout::Screen RETURNING_SCREEN = {"Returning", "Dist:     mm", RETURNING_FIELDS, 1};
+
+Station::Station(uint8_t index, const Pins& pins, Settings& settings)
+    : _index(index), _pins(pins), _settings(settings), _display(NULL), _layout(NULL), _positionStore(NULL),
+      _indicator(NULL), _cycleDone(NULL), _stepper(pins.step, pins.dir), _strokeMotion(_stepper),
+      _stateTimer(TimerService::NO_TIMER), _refreshTimer(TimerService::NO_TIMER), _stateTimerExpired(false),
+      _refreshDue(false), _startButton(pins.start, "Start"), _endstop(pins.endstop, "Limit", false), _state(STARTUP), _previousState(STARTUP), _stateJustChanged(true),
+      _errorMessage(""), _homingPhase(HOMING_WAIT_CONFIRM), _verifyingPosition(false),
+      _homed(false), _stateAfterHoming(IDLE),
+      _startArmed(false), _heaterOn(false), _driverReleased(false), _parked(false),
+      _endstopTripped(false), _endstopHigh(false), _endstopHighSince(0), _cycleActive(false), _heaterOnSince(0), _lastUpdateMicros(0) {
+    memset(&_cycle, 0, sizeof(_cycle));
+    _lock = xSemaphoreCreateRecursiveMutexStatic(&_lockBuffer);
+}
+
+Station::~Station() {
+    timerService.release(_stateTimer);
+    timerService.release(_refreshTimer);
+    vSemaphoreDelete(_lock);
+}
+
+// Sets up the pins with the driver disabled and the heater off, and starts in STARTUP
+void Station::begin(IndicatorFunction indicator, CycleFunction cycleDone) {
+    _indicator = indicator;
+    _cycleDone = cycleDone;
+
+    pinMode(_pins.step, OUTPUT);
+    pinMode(_pins.dir, OUTPUT);
+    pinMode(_pins.enable, OUTPUT);
+    digitalWrite(_pins.enable, HIGH);  // Set the ENABLE pin HIGH by default
+    pinMode(_pins.relay, OUTPUT);
+    digitalWrite(_pins.relay, LOW);  // Set the relay pin LOW by default
+    if (_pins.heaterLed != NO_PIN) {
+        pinMode(_pins.heaterLed, OUTPUT);
+    }
+    _startButton.begin();
+    _endstop.begin();
+
+    // Configure stepper
+    _stepper.setMaxSpeed(_settings.getSpeed());
+    _stepper.setAcceleration(ACCELERATION);
+    _stepper.setJerk(JERK);
+    _stepper.moveTo(0);  // Start at home position
+
+    _timer.onExpiry(cookTimeUp, this);
+    _stateTimer = timerService.create(stateTimeUp, this);
+    _refreshTimer = timerService.create(refreshTick, this);
+
+    changeState(STARTUP);
+    if (_stateTimer == TimerService::NO_TIMER || _refreshTimer == TimerService::NO_TIMER) {
+        fail("Out of timers", millis());
+    }
+}
+
+// Display and stored position; stations without them run headless. The
+// station with the display also gets the rotary switch and encoder events.
+void Station::attachUserInterface(MatrixDisplay* display, LcdLayout* layout, PositionStore* positionStore) {
+    _display = display;
+    _layout = layout;
+    _positionStore = positionStore;
+}
+
+// One input event for the current state, used here or dropped. A state
+// whose entry code has not run yet drops events too.
+void Station::handleEvent(const InputEvent& event, unsigned long currentTime) {
+    lock();
+    bool startButton = event.source == InputEvent::SOURCE_START;
+    if (!_stateJustChanged) {
+        switch (_state) {
+            case HOMING:
+                // Headless stations confirm with their Start button
+                if (_homingPhase == HOMING_WAIT_CONFIRM && event.type == InputEvent::PRESS &&
+                    event.source == (_display ? InputEvent::SOURCE_ROTARY_SWITCH : InputEvent::SOURCE_START)) {
+                    confirmHoming();
+                }
+                break;
+            case IDLE:
+                if (startButton && event.type == InputEvent::PRESS) {
+                    _startArmed = true;
+                } else if (startButton && event.type == InputEvent::LONG_PRESS && _startArmed) {
+                    park();
+                } else if (startButton && event.type == InputEvent::RELEASE && _startArmed) {
+                    start();
+                } else if (event.source == InputEvent::SOURCE_ROTARY_SWITCH && event.type == InputEvent::LONG_PRESS) {
+                    changeState(SETTINGS_MENU);
+                    _settings.enter();  // Enter settings menu
+                }
+                break;
+            case RUNNING:
+                if (startButton && event.type == InputEvent::PRESS) {
+                    endCooking(CycleLog::END_ABORTED, currentTime);
+                }
+                break;
+            case SETTINGS_MENU:
+                if (!startButton) {
+                    _settings.handleEvent(event);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    unlock();
+}
+
+// One pass of the state machine
+void Station::update(unsigned long currentTime) {
+    lock();
+
+    // Loop latency as this station sees it, logged with the cycle
+    unsigned long now = micros();
+    if (_cycleActive && now - _lastUpdateMicros > _cycle.peakLatency) {
+        _cycle.peakLatency = now - _lastUpdateMicros;
+    }
+    _lastUpdateMicros = now;
+
+    _endstop.update();
+
+    // Check for homing switch trigger in any state except HOMING, STARTUP, and ERROR
+    if (_state != HOMING && _state != STARTUP && _state != ERROR && (_endstop.getState() || _endstopTripped)) {
+        fail("Endstop trigger", currentTime);
+    } else {
+        switch (_state) {
+            case STARTUP:
+                handleStartup();
+                break;
+            case HOMING:
+                handleHoming(currentTime);
+                break;
+            case IDLE:
+                handleIdle();
+                break;
+            case RUNNING:
+                handleRunning(currentTime);
+                break;
+            case RETURNING_TO_START:
+                handleReturningToStart();
+                break;
+            case ERROR:
+                handleError();
+                break;
+            case SETTINGS_MENU:
+                handleSettingsMenu();
+                break;
+            case PARKING:
+                handleParking();
+                break;
+        }
+    }
+
+    // Reset changed states after handling
+    _endstop.reset();
+
+    unlock();
+}
+
+// Stepper poll and safety checks between updates, from the scheduler or a MotionTask.
+// False without polling when the control loop holds the station. With queued
+// stepping the poll refills the step queue, the steps already queued go on.
+bool Station::serviceMotion() {
+    if (xSemaphoreTakeRecursive(_lock, 0) != pdTRUE) return false;
+    checkSafety();
+    if (isMoving() && !_endstopTripped) {
+        _stepper.run();
+    }
+    xSemaphoreGiveRecursive(_lock);
+    return true;
+}
+
+// Due steps from the queue, in the timer interrupt; microseconds until the next one, 0 for none
+uint32_t IRAM_ATTR Station::pulse(unsigned long now) {
+    return _stepper.pulse(now);
+}
+
+// Call while the carriage stands still
+void Station::setQueuedStepping(bool queued) {
+    lock();
+    _stepper.setQueued(queued);
+    unlock();
+}
+
+// Starts a cook, only from IDLE like the Start button
+bool Station::start() {
+    if (_state != IDLE) return false;
+    lock();
+    startAfterHoming(RUNNING);
+    unlock();
+    return true;
+}
+
+// Remote abort, logged apart from the Start button
+bool Station::abort(unsigned long currentTime) {
+    if (_state != RUNNING) return false;
+    lock();
+    endCooking(CycleLog::END_REMOTE, currentTime);
+    unlock();
+    return true;
+}
+
+bool Station::park() {
+    if (_state != IDLE) return false;
+    lock();
+    startAfterHoming(PARKING);
+    unlock();
+    return true;
+}
+
+// Enters state, after homing again when the driver was released since the last homing
+void Station::startAfterHoming(SystemState state) {
+    if (_homed) {
+        changeState(state);
+    } else {
+        _stateAfterHoming = state;
+        changeState(HOMING);
+    }
+}
+
+// Enters ERROR with a message and switches the outputs off right away
+void Station::fail(const char* message, unsigned long currentTime) {
+    lock();
+    if (_state != ERROR) {
+        changeState(ERROR);
+    }
+    _errorMessage = message;
+    handleError();
+    finishCycle(CycleLog::END_ERROR, currentTime);
+    unlock();
+}
+
+// Called from the deadline guard when the loop stalls, so it only touches the pins
+void Station::forceSafeOutputs() {
+    digitalWrite(_pins.relay, LOW);
+    if (_pins.heaterLed != NO_PIN) {
+        digitalWrite(_pins.heaterLed, LOW);
+    }
+    digitalWrite(_pins.enable, HIGH);
+}
+
+// Idle power saving: releases the stepper driver, or enables it again unless in ERROR
+void Station::releaseDriver(bool release) {
+    if (release == _driverReleased) return;
+    lock();
+    _driverReleased = release;
+    if (release) {
+        digitalWrite(_pins.enable, HIGH);  // Disable the stepper motor
+        // The carriage can be pushed by hand and enabling the driver again snaps it to a full step,
+        // so the next start or park verifies the home position first
+        _homed = false;
+    } else if (_state != ERROR) {
+        digitalWrite(_pins.enable, LOW);  // Enable it again before the next move
+    }
+    unlock();
+}
+
+uint8_t Station::getIndex() const {
+    return _index;
+}
+
+SystemState Station::getState() const {
+    return _state;
+}
+
+bool Station::isParked() const {
+    return _parked;
+}
+
+// States that step the carriage
+bool Station::isMoving() const {
+    return _state == HOMING || _state == RUNNING || _state == RETURNING_TO_START || (_state == PARKING && !_parked);
+}
+
+bool Station::isHeaterOn() const {
+    return _heaterOn;
+}
+
+// Polled by the InputBus, which sends its events back through handleEvent()
+ButtonHandler& Station::getStartButton() {
+    return _startButton;
+}
+
+unsigned long Station::getRemainingTime() const {
+    return _timer.getRemainingTime();
+}
+
+long Station::getPosition() const {
+    return _stepper.currentPosition();
+}
+
+const char* Station::getErrorMessage() const {
+    return _errorMessage;
+}
+
+void Station::getStatus(Status& status) const {
+    status.state = _state;
+    status.heaterOn = _heaterOn;
+    status.moving = isMoving();
+    status.position = _stepper.currentPosition();
+    status.target = _stepper.targetPosition();
+    status.remainingTime = _timer.getRemainingTime();
+    status.error = _errorMessage;
+}
+
+uint32_t Station::getStepLateness() const {
+    return _stepper.getWorstLateness();
+}
+
+uint32_t Station::getStepUnderruns() const {
+    return _stepper.getUnderruns();
+}
+
+void Station::resetStepLateness() {
+    _stepper.resetLateness();
+}
+
+// Function to convert SystemState to string
+const char* Station::getStateName(uint8_t state) {
+    switch (state) {
+        case STARTUP: return "STARTUP";
+        case HOMING: return "HOMING";
+        case IDLE: return "IDLE";
+        case RUNNING: return "RUNNING";
+        case RETURNING_TO_START: return "RETURNING_TO_START";
+        case ERROR: return "ERROR";
+        case SETTINGS_MENU: return "SETTINGS_MENU";
+        case PARKING: return "PARKING";
+        default: return "UNKNOWN";
+    }
+}
+
+void Station::changeState(SystemState newState) {
+    _previousState = _state;
+    _state = newState;
+    _stateJustChanged = true;
+    timerService.stop(_stateTimer);
+    timerService.stop(_refreshTimer);
+    _stateTimerExpired = false;
+    _startArmed = false;
+
+    // A move must not start on a driver the power policy released
+    if (_driverReleased && newState != ERROR) {
+        releaseDriver(false);
+    }
+}
+
+void Station::handleStartup() {
+    if (_stateJustChanged) {
+        show("OrangeMakers", "Marshmallow 2.0");
+        startStateTimer(WELCOME_DURATION);
+        _stateJustChanged = false;
+    }
+
+    if (_stateTimerExpired) {
+        changeState(HOMING);
+    }
+}
+
+// The operator confirmed, start the homing moves
+void Station::confirmHoming() {
+    startStateTimer(HOMING_TIMEOUT);
+    digitalWrite(_pins.enable, LOW);  // Enable the stepper motor
+    if (_verifyingPosition) {
+        // Warm restart or released driver: travel at full speed to just short of the switch, then touch it slowly
+        _stepper.setMaxSpeed(MOVE_TO_ZERO_SPEED);
+        _stepper.setAcceleration(ACCELERATION);
+        _stepper.setJerk(JERK);
+        _stepper.moveTo(HOMING_SWITCH_POSITION - HOMING_BACKOFF_STEPS * DIRECTION_HOME);
+        show("Homing:", "Verifying");
+    } else {
+        startFastApproach();
+    }
+    invalidatePosition();  // Position is unknown until homing completes
+    _homingPhase = _verifyingPosition ? HOMING_BACKOFF : HOMING_FAST_APPROACH;
+}
+
+// Fast approach towards the switch from an unknown position
+void Station::startFastApproach() {
+    _stepper.setMaxSpeed(HOMING_FAST_SPEED);
+    _stepper.setAcceleration(ACCELERATION * 4);  // Set higher acceleration and jerk for a short overshoot past the switch
+    _stepper.setJerk(JERK * 20);
+    _stepper.move(DIRECTION_HOME * 1000000);  // Large number to ensure continuous movement
+    show("Homing:", "In progress");
+}
+
+void Station::handleHoming(unsigned long currentTime) {
+    if (_stateJustChanged) {
+        _homingPhase = HOMING_WAIT_CONFIRM;
+        _stateJustChanged = false;
+        indicate(INDICATOR_HOMING);
+        if (_stateAfterHoming != IDLE) {
+            // The operator's start or park confirms, the step count is still close to the carriage
+            _verifyingPosition = true;
+            confirmHoming();
+        } else {
+            _verifyingPosition = _positionStore != NULL && _positionStore->hasValidPosition();
+            if (_verifyingPosition) {
+                _stepper.setCurrentPosition(_positionStore->getPosition());
+            }
+            show(_verifyingPosition ? "To verify home" : "To start homing", _display ? "press rotary" : "press start");
+        }
+    }
+
+    if (_homingPhase != HOMING_WAIT_CONFIRM && _stateTimerExpired) {
+        // Homing timeout
+        fail("Homing failed", currentTime);
+        return;
+    }
+
+    switch (_homingPhase) {
+        case HOMING_WAIT_CONFIRM:
+            break;  // Until confirmHoming()
+
+        case HOMING_FAST_APPROACH:
+            if (_endstop.getState()) {
+                // Decelerate and reverse to a point just short of the switch
+                _stepper.move(HOMING_BACKOFF_STEPS * -DIRECTION_HOME);
+                _homingPhase = HOMING_BACKOFF;
+            } else {
+                _stepper.run();
+            }
+            break;
+
+        case HOMING_BACKOFF:
+            if (_verifyingPosition && _endstop.getState()) {
+                // Switch reached earlier than expected, the stored position was wrong
+                _verifyingPosition = false;
+                _stepper.setAcceleration(ACCELERATION * 4);
+                _stepper.setJerk(JERK * 20);
+                _stepper.move(HOMING_BACKOFF_STEPS * -DIRECTION_HOME);
+            } else if (_stepper.distanceToGo() == 0) {
+                if (_endstop.getState()) {
+                    // Switch did not release after backing off
+                    fail("Homing failed", currentTime);
+                    return;
+                }
+                _stepper.setMaxSpeed(HOMING_SLOW_SPEED);
+                _stepper.move(HOMING_SEARCH_STEPS * DIRECTION_HOME);
+                _homingPhase = HOMING_SLOW_APPROACH;
+            } else {
+                _stepper.run();
+            }
+            break;
+
+        case HOMING_SLOW_APPROACH:
+            if (_endstop.getState()) {
+                // The trigger point defines the machine coordinates
+                _stepper.setCurrentPosition(HOMING_SWITCH_POSITION.value());
+                _stepper.setMaxSpeed(MOVE_TO_ZERO_SPEED);
+                _stepper.setAcceleration(ACCELERATION);  // Restore original acceleration and jerk
+                _stepper.setJerk(JERK);
+                _stepper.moveTo(0);
+                _homingPhase = HOMING_MOVE_TO_ZERO;
+                show("Homing:", "Move to Zero");
+            } else if (_stepper.distanceToGo() == 0) {
+                if (_verifyingPosition) {
+                    // Switch not found where expected, fall back to a full homing run
+                    _verifyingPosition = false;
+                    startStateTimer(HOMING_TIMEOUT);
+                    startFastApproach();
+                    _homingPhase = HOMING_FAST_APPROACH;
+                } else {
+                    fail("Homing failed", currentTime);
+                    return;
+                }
+            } else {
+                _stepper.run();
+            }
+            break;
+
+        case HOMING_MOVE_TO_ZERO:
+            if (_stepper.distanceToGo() == 0) {
+                // Finished moving away from switch
+                _stepper.setMaxSpeed(_settings.getSpeed());  // Restore original max speed
+                savePosition(0);
+                #ifdef DEBUG
+                Serial.print("Station ");
+                Serial.print(_index);
+                Serial.println(" homing completed!");
+                #endif
+                _homed = true;
+                if (_stateAfterHoming == IDLE) {
+                    show("Homing:", "Completed", 2000);
+                }
+                changeState(_stateAfterHoming);
+                _stateAfterHoming = IDLE;
+            } else {
+                _stepper.run();
+            }
+            break;
+    }
+}
+
+void Station::handleIdle() {
+    if (_stateJustChanged) {
+        show("Idle..", "Press Start");
+        _stateJustChanged = false;
+        indicate(INDICATOR_IDLE);
+    }
+
+    // Start, park and the settings menu come from handleEvent()
+}
+
+void Station::handleRunning(unsigned long currentTime) {
+    if (_stateJustChanged) {
+        _stateJustChanged = false;
+        show("Cooking", "Started");
+        _timer.start(_settings.getCookTime());
+        _stepper.setMaxSpeed(_settings.getSpeed());  // Set the correct max speed
+        _strokeMotion.configure(Steps(0), _settings.getTotalSteps() * DIRECTION_RUN, _settings.getSpeed(), ACCELERATION, STROKE_JERK, STROKE_DWELL);
+        _strokeMotion.start();
+        startRefresh();
+        invalidatePosition();  // Position is only kept while the carriage is at rest
+        startCycle(currentTime);
+        startHeater(); // Start the heater when entering the running state
+        indicate(INDICATOR_RUNNING);
+    }
+
+    if (_timer.hasExpired()) {
+        endCooking(CycleLog::END_DONE, currentTime);
+        return;
+    }
+
+    _strokeMotion.update();
+
+    // Update LCD with remaining time, progress and distance at specified interval
+    if (refreshDue()) {
+        unsigned long cookTime = _settings.getCookTime().value();
+        unsigned long remainingTime = _timer.getRemainingTime();
+        int32_t progress = cookTime > 0 ? (static_cast<uint64_t>(cookTime - remainingTime) * LcdLayout::PROGRESS_FULL) / cookTime
+                                        : LcdLayout::PROGRESS_FULL;
+        showField(RUNNING_SCREEN, 0, remainingTime / 1000);  // Convert to seconds
+        showField(RUNNING_SCREEN, 1, progress);
+        showField(RUNNING_SCREEN, 2, lroundf(fabsf(_stepper.currentDistance().value()) * 10.0f));
+    }
+}
+
+// Stops the heater and returns the carriage, for an abort or a finished cook
+void Station::endCooking(CycleLog::EndReason reason, unsigned long currentTime) {
+    stopHeater(); // Stop the heater
+    changeState(RETURNING_TO_START);
+    show("Cooking", reason == CycleLog::END_DONE ? "Done" : "Aborted");
+    _strokeMotion.stop();  // Decelerate before returning to the start position
+    _timer.stop();
+    finishCycle(reason, currentTime);
+}
+
+void Station::handleReturningToStart() {
+    if (_stateJustChanged) {
+        _stateJustChanged = false;
+        _stepper.setMaxSpeed(_settings.getSpeed());  // Set the correct max speed
+        startRefresh();
+        stopHeater(); // Stop the heater when returning to start
+        indicate(INDICATOR_RETURNING);
+        if (!_strokeMotion.isRunning()) {
+            _stepper.moveTo(0);  // Set target to start position
+        }
+    }
+
+    if (_strokeMotion.isRunning()) {
+        // Let the cooking strokes come to a standstill first
+        _strokeMotion.update();
+        if (!_strokeMotion.isRunning()) {
+            _stepper.moveTo(0);  // Set target to start position
+        }
+    } else if (_stepper.distanceToGo() == 0) {
+        // We've reached the start position
+        savePosition(_stepper.currentPosition());
+        changeState(IDLE);
+        show("Returned to", "Start Position");
+    } else {
+        _stepper.run();
+
+        if (refreshDue()) {
+            showField(RETURNING_SCREEN, 0, lroundf(fabsf(_stepper.currentDistance().value()) * 10.0f));
+        }
+    }
+}
+
+void Station::handleError() {
+    if (_stateJustChanged) {
+        // Set the ENABLE pin HIGH to disable the stepper driver
+        digitalWrite(_pins.enable, HIGH);
+        stopHeater(); // Stop the heater in case of an error
+        _strokeMotion.halt();
+        invalidatePosition();
+        _stateJustChanged = false;
+    }
+
+    // Always display the error message
+    show("Error", _errorMessage);
+
+    // In ERROR state, we don't do anything else until the device is reset
+}
+
+void Station::handleSettingsMenu() {
+    if (_stateJustChanged) {
+        _stateJustChanged = false;  // Settings::enter() drew the menu, events go to it from now on
+    }
+    if (!_settings.isDone()) {
+        _settings.update();
+    }
+    if (_settings.isDone()) {
+        changeState(IDLE);
+    }
+}
+
+void Station::handleParking() {
+    if (_stateJustChanged) {
+        _stateJustChanged = false;
+        _parked = false;
+        show("Parking", "Please wait");
+        digitalWrite(_pins.enable, LOW);  // Enable the stepper motor
+        _stepper.setMaxSpeed(_settings.getSpeed());
+        _stepper.setAcceleration(ACCELERATION);
+        _stepper.setJerk(JERK);
+        _stepper.moveTo(Drive::toSteps(PARK_DISTANCE) * DIRECTION_HOME);
+        invalidatePosition();
+    }
+
+    if (_parked) return;
+
+    if (_stepper.distanceToGo() == 0) {
+        // Parking completed, the station stays here until the power is turned off
+        savePosition(_stepper.currentPosition());
+        digitalWrite(_pins.enable, HIGH);  // Disable the stepper motor
+        show("Please turn off", "The power");
+        _parked = true;
+    } else {
+        _stepper.run();
+    }
+}
+
+// Takes the settings the cook runs with
+void Station::startCycle(unsigned long currentTime) {
+    memset(&_cycle, 0, sizeof(_cycle));
+    _cycle.station = _index;
+    _cycle.startTime = currentTime;
+    _cycle.cookTime = _settings.getCookTime().value();
+    _cycle.totalDistance = lroundf(_settings.getTotalDistance().value() * 1000.0f);
+    _cycle.speed = lroundf(_settings.getSpeed().value());
+    _cycleActive = true;
+}
+
+// Call with the heater already off, so its on-time is complete
+void Station::finishCycle(CycleLog::EndReason reason, unsigned long currentTime) {
+    if (!_cycleActive) return;
+    _cycleActive = false;
+    unsigned long strokes = _strokeMotion.getStrokeCount();
+    _cycle.endReason = reason;
+    _cycle.duration = currentTime - _cycle.startTime;
+    _cycle.strokes = strokes > 0xFFFF ? 0xFFFF : strokes;
+    if (_cycleDone) {
+        _cycleDone(_cycle);
+    }
+}
+
+void Station::startStateTimer(unsigned long duration) {
+    _stateTimerExpired = false;
+    timerService.startOnce(_stateTimer, static_cast<uint64_t>(duration) * 1000);
+}
+
+// Only the station with the display refreshes it; the first refresh is due at once
+void Station::startRefresh() {
+    if (!_layout) return;
+    _refreshDue = true;
+    timerService.startPeriodic(_refreshTimer, static_cast<uint64_t>(LCD_UPDATE_INTERVAL) * 1000);
+}
+
+bool Station::refreshDue() {
+    if (!_refreshDue) return false;
+    _refreshDue = false;
+    return true;
+}
+
+// Draws the screen's fixed text first if something else is on the display
+void Station::showField(const LcdLayout::Screen& screen, uint8_t field, int32_t value) {
+    if (!_layout->isShowing(screen)) {
+        _layout->show(screen);
+    }
+    _layout->set(field, value);
+}
+
+// Timer task: the heater goes off when the cook time is up, the state handler finishes the cook on its next pass
+void Station::cookTimeUp(void* arg) {
+    Station* station = static_cast<Station*>(arg);
+    digitalWrite(station->_pins.relay, LOW);
+    if (station->_pins.heaterLed != NO_PIN) {
+        digitalWrite(station->_pins.heaterLed, LOW);
+    }
+}
+
+void Station::stateTimeUp(void* arg) {
+    static_cast<Station*>(arg)->_stateTimerExpired = true;
+}
+
+void Station::refreshTick(void* arg) {
+    static_cast<Station*>(arg)->_refreshDue = true;
+}
+
+void Station::lock() {
+    xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+}
+
+void Station::unlock() {
+    xSemaphoreGiveRecursive(_lock);
+}
+
+// At the motion rate: stops the carriage on the endstop without waiting for the
+// debounce, and keeps the heater off outside a cook. Called with the lock held.
+void Station::checkSafety() {
+    if (isMoving() && _state != HOMING && digitalRead(_pins.endstop) == HIGH) {
+        if (!_endstopHigh) {
+            _endstopHigh = true;
+            _endstopHighSince = micros();
+        } else if (!_endstopTripped && micros() - _endstopHighSince >= ENDSTOP_TRIP_TIME) {
+            _endstopTripped = true;
+            forceSafeOutputs();
+            _stepper.setCurrentPosition(_stepper.currentPosition());  // Drops the queued steps
+        }
+    } else {
+        _endstopHigh = false;
+    }
+
+    if (_heaterOn && _state != RUNNING) {
+        stopHeater();
+    }
+}
+
+void Station::startHeater() {
+    digitalWrite(_pins.relay, HIGH);
+    if (_pins.heaterLed != NO_PIN) {
+        digitalWrite(_pins.heaterLed, HIGH);
+    }
+    if (!_heaterOn) {
+        _heaterOnSince = millis();
+    }
+    _heaterOn = true;
+}
+
+void Station::stopHeater() {
+    digitalWrite(_pins.relay, LOW);
+    if (_pins.heaterLed != NO_PIN) {
+        digitalWrite(_pins.heaterLed, LOW);
+    }
+    if (_heaterOn) {
+        _cycle.heaterOnTime += millis() - _heaterOnSince;
+    }
+    _heaterOn = false;
+}
+
+void Station::show(const char* row1, const char* row2) {
+    if (_display) {
+        _display->updateDisplay(row1, row2);
+    }
+    if (_layout) {
+        _layout->hide();
+    }
+}
+
+void Station::show(const String& row1, const String& row2, unsigned long duration) {
+    if (_display) {
+        _display->updateDisplay(row1, row2, duration);
+    }
+    if (_layout) {
+        _layout->hide();
+    }
+}
+
+void Station::indicate(Indicator indicator) {
+    if (_indicator) {
+        _indicator(_index, indicator);
+    }
+}
+
+void Station::savePosition(long position) {
+    if (_positionStore) {
+        _positionStore->save(position);
+    }
+}
+
+void Station::invalidatePosition() {
+    if (_positionStore) {
+        _positionStore->invalidate();
+    }
+}
@@ -0,0 +1,120 @@
+#include "StationScheduler.h"
+
+StationScheduler::StationScheduler(uint32_t stepBudget)
+    : _count(0), _first(0), _motionPolling(true), _stepBudget(stepBudget), _worstPass(0), _passes(0), _overBudgetPasses(0) {}
+
+bool StationScheduler::add(Station& station) {
+    if (_count >= MAX_STATIONS) return false;
+    _stations[_count++] = &station;
+    return true;
+}
+
+// One pass over all stations
+void StationScheduler::service(unsigned long currentTime) {
+    if (_count == 0) return;
+
+    unsigned long start = micros();
+    uint32_t latenessBefore = getWorstStepLateness();
+
+    uint8_t index = _first;
+    for (uint8_t i = 0; i < _count; i++) {
+        _stations[index]->update(currentTime);
+        if (_motionPolling) {
+            serviceMotion();
+        }
+        index = index + 1 < _count ? index + 1 : 0;
+    }
+    _first = _first + 1 < _count ? _first + 1 : 0;
+
+    uint32_t duration = micros() - start;
+    _passes++;
+    if (duration > _worstPass) {
+        _worstPass = duration;
+    }
+    uint32_t lateness = getWorstStepLateness();
+    if (lateness > _stepBudget && lateness > latenessBefore) {
+        _overBudgetPasses++;
+    }
+}
+
+// Polls every stepper once, returns how many stations were busy in an update on another task
+uint8_t StationScheduler::serviceMotion() {
+    uint8_t busy = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (!_stations[i]->serviceMotion()) {
+            busy++;
+        }
+    }
+    return busy;
+}
+
+// Due steps on every station, from the MotionTask's timer interrupt.
+// Microseconds until the next step on any station, 0 when none is queued.
+uint32_t IRAM_ATTR StationScheduler::pulse(unsigned long now) {
+    uint32_t next = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        uint32_t wait = _stations[i]->pulse(now);
+        if (wait != 0 && (next == 0 || wait < next)) {
+            next = wait;
+        }
+    }
+    return next;
+}
+
+// Off while a MotionTask drives the steppers, which then queue their steps for its timer interrupt
+void StationScheduler::setMotionPolling(bool enabled) {
+    _motionPolling = enabled;
+    for (uint8_t i = 0; i < _count; i++) {
+        _stations[i]->setQueuedStepping(!enabled);
+    }
+}
+
+uint8_t StationScheduler::getCount() const {
+    return _count;
+}
+
+Station& StationScheduler::getStation(uint8_t index) {
+    return *_stations[index < _count ? index : 0];
+}
+
+uint32_t StationScheduler::getWorstPass() const {
+    return _worstPass;
+}
+
+uint32_t StationScheduler::getPasses() const {
+    return _passes;
+}
+
+uint32_t StationScheduler::getOverBudgetPasses() const {
+    return _overBudgetPasses;
+}
+
+// Latest step across all stations since the last reset, in microseconds
+uint32_t StationScheduler::getWorstStepLateness() const {
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        uint32_t lateness = _stations[i]->getStepLateness();
+        if (lateness > worst) {
+            worst = lateness;
+        }
+    }
+    return worst;
+}
+
+// Step queue underruns across all stations since the last reset
+uint32_t StationScheduler::getStepUnderruns() const {
+    uint32_t underruns = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        underruns += _stations[i]->getStepUnderruns();
+    }
+    return underruns;
+}
+
+void StationScheduler::resetStats() {
+    _worstPass = 0;
+    _passes = 0;
+    _overBudgetPasses = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        _stations[i]->resetStepLateness();
+    }
+}
@@ -0,0 +1,85 @@
+#include "StrokeMotion.h"
+
+StrokeMotion::StrokeMotion(MotionStepper& stepper)
+    : _stepper(stepper), _ends{0, 0}, _targetEnd(1), _maxSpeed(0), _acceleration(0), _jerk(0), _dwellTime(0),
+      _running(false), _stopping(false), _dwelling(false), _dwellStartTime(0), _strokeCount(0) {}
+
+void StrokeMotion::configure(Steps startPosition, Steps endPosition, StepsPerSecond maxSpeed, float acceleration, float jerk, Millis dwellTime) {
+    _ends[0] = startPosition.value();
+    _ends[1] = endPosition.value();
+    _maxSpeed = maxSpeed.value();
+    _acceleration = acceleration;
+    _jerk = jerk;
+    _dwellTime = dwellTime.value();
+}
+
+void StrokeMotion::start() {
+    long position = _stepper.currentPosition();
+    // Head for the end furthest away
+    _targetEnd = labs(_ends[1] - position) >= labs(_ends[0] - position) ? 1 : 0;
+    _stopping = false;
+    _dwelling = false;
+    _strokeCount = 0;
+    _stepper.setMaxSpeed(_maxSpeed);
+    _stepper.setAcceleration(_acceleration);
+    _stepper.setJerk(_jerk);
+    _stepper.moveTo(_ends[_targetEnd]);
+    _running = true;
+}
+
+void StrokeMotion::stop() {
+    // Decelerate to a standstill, isRunning() turns false once stopped
+    if (_running && !_stopping) {
+        _stopping = true;
+        _stepper.stop();
+    }
+}
+
+void StrokeMotion::halt() {
+    // Immediate stop, for when the driver is being disabled anyway
+    _running = false;
+    _stepper.setCurrentPosition(_stepper.currentPosition());
+}
+
+bool StrokeMotion::isRunning() const {
+    return _running;
+}
+
+unsigned long StrokeMotion::getStrokeCount() const {
+    return _strokeCount;
+}
+
+void StrokeMotion::nextStroke() {
+    _targetEnd = 1 - _targetEnd;
+    _strokeCount++;
+    _stepper.moveTo(_ends[_targetEnd]);
+}
+
+void StrokeMotion::update() {
+    if (!_running) return;
+
+    if (_stopping) {
+        if (!_stepper.run()) {
+            _running = false;
+        }
+        return;
+    }
+
+    if (_dwelling) {
+        if (millis() - _dwellStartTime < _dwellTime) return;
+        _dwelling = false;
+        nextStroke();
+    } else if (_dwellTime == 0) {
+        // Blend the reversal into the deceleration. The motion task steps on its
+        // own, so the stroke may also have ended since the last update.
+        if (_stepper.isBraking() || !_stepper.isRunning()) {
+            nextStroke();
+        }
+    } else if (!_stepper.isRunning()) {
+        _dwelling = true;
+        _dwellStartTime = millis();
+        return;
+    }
+
+    _stepper.run();
+}
@@ -0,0 +1,110 @@
+#include "TaskTable.h"
+
+TaskTable::TaskTable() : _count(0), _passes(0), _totalOverruns(0) {}
+
+// period in milliseconds, budget in microseconds
+bool TaskTable::add(const char* name, TickFunction tick, unsigned long period, Priority priority, uint32_t budget) {
+    if (_count >= MAX_TASKS || tick == NULL) return false;
+    Task& task = _tasks[_count];
+    task.tick = tick;
+    task.nextRun = 0;
+    task.started = false;
+    Stats& stats = _stats[_count];
+    stats.name = name;
+    stats.period = period;
+    stats.priority = priority;
+    stats.budget = budget;
+    stats.worst = 0;
+    stats.runs = 0;
+    stats.overruns = 0;
+    stats.deferrals = 0;
+    _count++;
+    return true;
+}
+
+// True when a due tick may run this far into the pass
+bool TaskTable::mayRun(uint8_t index, unsigned long currentTime, uint32_t passTime, uint32_t passBudget) const {
+    const Stats& stats = _stats[index];
+    if (stats.priority == PRIORITY_HIGH || stats.period == 0) return true;
+    // Waited a whole period already, so it runs regardless
+    if (static_cast<long>(currentTime - _tasks[index].nextRun) >= static_cast<long>(stats.period)) return true;
+    uint32_t limit = stats.priority == PRIORITY_LOW ? passBudget / 2 : passBudget;
+    return passTime < limit;
+}
+
+// One loop pass, passBudget in microseconds
+void TaskTable::run(unsigned long currentTime, uint32_t passBudget) {
+    unsigned long passStart = micros();
+    unsigned long start = passStart;  // The end of the previous tick, skipped ticks take no time
+    for (uint8_t i = 0; i < _count; i++) {
+        Task& task = _tasks[i];
+        Stats& stats = _stats[i];
+        if (task.started && static_cast<long>(currentTime - task.nextRun) < 0) continue;
+
+        if (!mayRun(i, currentTime, start - passStart, passBudget)) {
+            stats.deferrals++;
+            continue;
+        }
+        task.tick(currentTime);
+        unsigned long end = micros();
+        uint32_t duration = end - start;
+        start = end;
+
+        stats.runs++;
+        if (duration > stats.worst) {
+            stats.worst = duration;
+        }
+        if (duration > stats.budget) {
+            stats.overruns++;
+            _totalOverruns++;
+        }
+
+        // Keeps the phase while on time, a tick that fell behind starts over from now instead of catching up
+        task.nextRun = task.started ? task.nextRun + stats.period : currentTime + stats.period;
+        if (static_cast<long>(currentTime - task.nextRun) >= 0) {
+            task.nextRun = currentTime + stats.period;
+        }
+        task.started = true;
+    }
+    _passes++;
+}
+
+uint8_t TaskTable::getCount() const {
+    return _count;
+}
+
+const TaskTable::Stats& TaskTable::getStats(uint8_t index) const {
+    return _stats[index < _count ? index : 0];
+}
+
+uint32_t TaskTable::getPasses() const {
+    return _passes;
+}
+
+uint32_t TaskTable::getTotalOverruns() const {
+    return _totalOverruns;
+}
+
+void TaskTable::resetStats() {
+    for (uint8_t i = 0; i < _count; i++) {
+        _stats[i].worst = 0;
+        _stats[i].runs = 0;
+        _stats[i].overruns = 0;
+        _stats[i].deferrals = 0;
+    }
+    _passes = 0;
+    _totalOverruns = 0;
+}
+
+void TaskTable::report(Print& out) const {
+    static const char* const PRIORITY_NAMES[] = {"low", "normal", "high"};
+    out.printf("Loop tasks (period ms, priority, budget / worst us, runs, overruns, deferrals) over %lu passes:\n",
+               static_cast<unsigned long>(_passes));
+    for (uint8_t i = 0; i < _count; i++) {
+        const Stats& stats = _stats[i];
+        out.printf("  %-12s %5lu %-6s %6lu %6lu %8lu %6lu %6lu\n", stats.name, stats.period,
+                   PRIORITY_NAMES[stats.priority], static_cast<unsigned long>(stats.budget),
+                   static_cast<unsigned long>(stats.worst), static_cast<unsigned long>(stats.runs),
+                   static_cast<unsigned long>(stats.overruns), static_cast<unsigned long>(stats.deferrals));
+    }
+}
@@ -1,27 +1,70 @@
 #include "Timer.h"
 
-Timer::Timer() : startTime(0), duration(0), running(false) {}
+Timer::Timer() : _id(TimerService::NO_TIMER), _callback(NULL), _arg(NULL), _running(false), _expired(false) {}
 
-void Timer::start(unsigned long duration) {
-    this->startTime = millis();
-    this->duration = duration;
-    this->running = true;
+Timer::~Timer() {
+    timerService.release(_id);
+}
+
+// Runs in the timer task, set before start()
+void Timer::onExpiry(Callback callback, void* arg) {
+    _callback = callback;
+    _arg = arg;
+}
+
+// Without a free timer slot the timer expires at once, so a cook can not run on unbounded
+void Timer::start(Millis duration) {
+    if (_id == TimerService::NO_TIMER) {
+        _id = timerService.create(expiryCallback, this);
+    }
+    _running = true;
+    _expired = false;
+    if (_id == TimerService::NO_TIMER) {
+        expiryCallback(this);
+        return;
+    }
+    timerService.startOnce(_id, static_cast<uint64_t>(duration.value()) * 1000);
 }
 
 void Timer::stop() {
-    running = false;
+    timerService.stop(_id);
+    _running = false;
+    _expired = false;
+}
+
+void Timer::pause() {
+    timerService.pause(_id);
+}
+
+void Timer::resume() {
+    timerService.resume(_id);
 }
 
 bool Timer::isRunning() const {
-    return running;
+    return _running;
+}
+
+bool Timer::isPaused() const {
+    return timerService.isPaused(_id);
 }
 
 bool Timer::hasExpired() const {
-    return running && (millis() - startTime >= duration);
+    return _running && _expired;
 }
 
 unsigned long Timer::getRemainingTime() const {
-    if (!running) return 0;
-    unsigned long elapsed = millis() - startTime;
-    return (elapsed >= duration) ? 0 : (duration - elapsed);
+    return getRemainingMicros() / 1000;
+}
+
+uint64_t Timer::getRemainingMicros() const {
+    if (!_running) return 0;
+    return timerService.getRemaining(_id);
+}
+
+void Timer::expiryCallback(void* arg) {
+    Timer* timer = static_cast<Timer*>(arg);
+    timer->_expired = true;
+    if (timer->_callback) {
+        timer->_callback(timer->_arg);
+    }
 }
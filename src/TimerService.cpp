@@ -0,0 +1,252 @@
+#include "TimerService.h"
+
+TimerService::TimerService() : _heapCount(0), _timerCount(0), _timer(NULL), _armedExpiry(0) {
+    for (uint8_t i = 0; i < MAX_TIMERS; i++) {
+        _entries[i].callback = NULL;
+        _entries[i].heapIndex = NO_TIMER;
+    }
+    _mutex = xSemaphoreCreateMutexStatic(&_mutexBuffer);
+}
+
+// Creates the esp_timer that drives every callback, false if it could not be created
+bool TimerService::begin() {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = timerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "timers";
+    if (esp_timer_create(&timerArgs, &_timer) != ESP_OK) {
+        _timer = NULL;
+        return false;
+    }
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    arm();  // Timers started before begin()
+    xSemaphoreGive(_mutex);
+    return true;
+}
+
+// NO_TIMER when all MAX_TIMERS are taken
+TimerService::TimerId TimerService::create(Callback callback, void* arg) {
+    if (callback == NULL) return NO_TIMER;
+    TimerId id = NO_TIMER;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < MAX_TIMERS; i++) {
+        if (_entries[i].callback == NULL) {
+            Entry& entry = _entries[i];
+            entry.callback = callback;
+            entry.arg = arg;
+            entry.expiry = 0;
+            entry.period = 0;
+            entry.remaining = 0;
+            entry.heapIndex = NO_TIMER;
+            entry.paused = false;
+            _timerCount++;
+            id = i;
+            break;
+        }
+    }
+    xSemaphoreGive(_mutex);
+    return id;
+}
+
+// Stops the timer and frees its slot. A callback already running is not waited for.
+void TimerService::release(TimerId id) {
+    if (!isValid(id)) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    unschedule(id);
+    _entries[id].callback = NULL;
+    _timerCount--;
+    arm();
+    xSemaphoreGive(_mutex);
+}
+
+void TimerService::startOnce(TimerId id, uint64_t delay) {
+    if (!isValid(id)) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _entries[id].period = 0;
+    _entries[id].paused = false;
+    schedule(id, now() + delay);
+    arm();
+    xSemaphoreGive(_mutex);
+}
+
+// First call one period from now
+void TimerService::startPeriodic(TimerId id, uint64_t period) {
+    if (!isValid(id) || period == 0) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _entries[id].period = period;
+    _entries[id].paused = false;
+    schedule(id, now() + period);
+    arm();
+    xSemaphoreGive(_mutex);
+}
+
+void TimerService::stop(TimerId id) {
+    if (!isValid(id)) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    unschedule(id);
+    _entries[id].paused = false;
+    arm();
+    xSemaphoreGive(_mutex);
+}
+
+// Keeps the time left until resume(), a periodic timer then continues with its period
+void TimerService::pause(TimerId id) {
+    if (!isValid(id)) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Entry& entry = _entries[id];
+    if (entry.heapIndex != NO_TIMER) {
+        uint64_t t = now();
+        entry.remaining = entry.expiry > t ? entry.expiry - t : 0;
+        unschedule(id);
+        entry.paused = true;
+        arm();
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void TimerService::resume(TimerId id) {
+    if (!isValid(id)) return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Entry& entry = _entries[id];
+    if (entry.paused) {
+        entry.paused = false;
+        schedule(id, now() + entry.remaining);
+        arm();
+    }
+    xSemaphoreGive(_mutex);
+}
+
+bool TimerService::isPending(TimerId id) const {
+    return isValid(id) && _entries[id].heapIndex != NO_TIMER;
+}
+
+bool TimerService::isPaused(TimerId id) const {
+    return isValid(id) && _entries[id].paused;
+}
+
+// Microseconds to the next call, 0 when stopped or due
+uint64_t TimerService::getRemaining(TimerId id) const {
+    if (!isValid(id)) return 0;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    const Entry& entry = _entries[id];
+    uint64_t remaining = 0;
+    if (entry.paused) {
+        remaining = entry.remaining;
+    } else if (entry.heapIndex != NO_TIMER) {
+        uint64_t t = now();
+        remaining = entry.expiry > t ? entry.expiry - t : 0;
+    }
+    xSemaphoreGive(_mutex);
+    return remaining;
+}
+
+uint8_t TimerService::getTimerCount() const {
+    return _timerCount;
+}
+
+uint64_t TimerService::now() {
+    return esp_timer_get_time();
+}
+
+bool TimerService::isValid(TimerId id) const {
+    return id < MAX_TIMERS && _entries[id].callback != NULL;
+}
+
+// The heap helpers and arm() are called with the mutex held
+void TimerService::schedule(TimerId id, uint64_t expiry) {
+    unschedule(id);
+    _entries[id].expiry = expiry;
+    place(_heapCount, id);
+    _heapCount++;
+    siftUp(_entries[id].heapIndex);
+}
+
+void TimerService::unschedule(TimerId id) {
+    uint8_t position = _entries[id].heapIndex;
+    if (position == NO_TIMER) return;
+    _entries[id].heapIndex = NO_TIMER;
+    _heapCount--;
+    if (position == _heapCount) return;
+
+    // Move the last timer into the gap and restore the order in whichever direction it is broken
+    TimerId moved = _heap[_heapCount];
+    place(position, moved);
+    siftUp(position);
+    siftDown(_entries[moved].heapIndex);
+}
+
+void TimerService::siftUp(uint8_t position) {
+    TimerId id = _heap[position];
+    while (position > 0) {
+        uint8_t parent = (position - 1) / 2;
+        if (_entries[_heap[parent]].expiry <= _entries[id].expiry) break;
+        place(position, _heap[parent]);
+        position = parent;
+    }
+    place(position, id);
+}
+
+void TimerService::siftDown(uint8_t position) {
+    TimerId id = _heap[position];
+    while (true) {
+        uint8_t child = 2 * position + 1;
+        if (child >= _heapCount) break;
+        if (child + 1 < _heapCount && _entries[_heap[child + 1]].expiry < _entries[_heap[child]].expiry) {
+            child++;
+        }
+        if (_entries[id].expiry <= _entries[_heap[child]].expiry) break;
+        place(position, _heap[child]);
+        position = child;
+    }
+    place(position, id);
+}
+
+void TimerService::place(uint8_t position, TimerId id) {
+    _heap[position] = id;
+    _entries[id].heapIndex = position;
+}
+
+// Points the esp_timer at the earliest expiry, only touching it when that changed
+void TimerService::arm() {
+    if (_timer == NULL) return;
+    uint64_t head = _heapCount > 0 ? _entries[_heap[0]].expiry : 0;
+    if (head == _armedExpiry) return;
+    esp_timer_stop(_timer);
+    _armedExpiry = head;
+    if (head != 0) {
+        uint64_t t = now();
+        esp_timer_start_once(_timer, head > t ? head - t : 0);
+    }
+}
+
+// Runs the due callbacks outside the mutex, so they may start and stop timers
+void TimerService::dispatch() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _armedExpiry = 0;  // The esp_timer has fired
+    for (uint8_t i = 0; i < MAX_TIMERS; i++) {  // Bounds the work of one call
+        uint64_t t = now();
+        if (_heapCount == 0 || _entries[_heap[0]].expiry > t) break;
+
+        TimerId id = _heap[0];
+        Entry& entry = _entries[id];
+        unschedule(id);
+        if (entry.period > 0) {
+            // Keep the phase, but skip calls that are already late rather than bunching them
+            uint64_t next = entry.expiry + entry.period;
+            schedule(id, next > t ? next : t + entry.period);
+        }
+        Callback callback = entry.callback;
+        void* arg = entry.arg;
+
+        xSemaphoreGive(_mutex);
+        callback(arg);
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+    arm();
+    xSemaphoreGive(_mutex);
+}
+
+void TimerService::timerCallback(void* arg) {
+    static_cast<TimerService*>(arg)->dispatch();
+}
@@ -3,29 +3,52 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
-#include <AccelStepper.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <ESP32Encoder.h>
+#include <freertos/queue.h>
 #include "MatrixDisplay.h"
-#include "Timer.h"
+#include "LcdLayout.h"
 #include "ButtonHandler.h"
+#include "RotaryInput.h"
+#include "InputBus.h"
+#include "InputTrace.h"
 #include "Settings.h"
 #include "MatrixDisplay.h"
+#include "PositionStore.h"
+#include "BootProfiler.h"
+#include "DeadlineMonitor.h"
+#include "TimerService.h"
+#include "MemoryMonitor.h"
+#include "PowerPolicy.h"
+#include "RemoteControl.h"
+#include "CaptiveDns.h"
+#include "CycleLog.h"
+#include "OtaUpdater.h"
+#include "Station.h"
+#include "StationScheduler.h"
+#include "MotionTask.h"
+#include "MachineSnapshot.h"
+#include "TaskTable.h"
+#include "SerialConsole.h"
+#include "Units.h"
 #include "FastLED.h"
 #include <WiFi.h>
 #include <ESPmDNS.h>
 #include <WiFiUdp.h>
 #include <ArduinoOTA.h>
-#include <DNSServer.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+#ifdef BENCHMARK
+#include "BenchmarkCases.h"
+#endif
 
 const char* ap_ssid = "Skumfidus";
 const char* ap_password = "OrangeMakers";
 const char* ota_password = "OrangeMakers";
 
-// DNS server
-const byte DNS_PORT = 53;
-DNSServer dnsServer;
+// Captive portal DNS, answered from the network stack's receive callback
+CaptiveDns captiveDns;
 
 #define START_BUTTON_PIN 15   // Start button pin
 #define HOMING_SWITCH_PIN 16  // Homing switch pin
@@ -39,13 +62,36 @@ DNSServer dnsServer;
 
 CRGB leds[NUM_LEDS];
 
-// Initialize ButtonHandler objects
-ButtonHandler buttonStart(START_BUTTON_PIN, "Start");
-ButtonHandler buttonLimitSwitch(HOMING_SWITCH_PIN, "Limit", false);
+// LED strip changes, drawn by a low-priority task so FastLED.show() never holds up the control loop
+struct LedUpdate {
+  uint8_t station;
+  Station::Indicator indicator;
+};
+const uint8_t LED_QUEUE_LENGTH = 8;
+const uint32_t LED_TASK_STACK_SIZE = 2048;  // Bytes
+QueueHandle_t ledQueue = NULL;
+StaticQueue_t ledQueueBuffer;
+uint8_t ledQueueStorage[LED_QUEUE_LENGTH * sizeof(LedUpdate)];
+StaticTask_t ledTaskBuffer;
+StackType_t ledTaskStack[LED_TASK_STACK_SIZE];
+TaskHandle_t ledTask = NULL;
+uint32_t ledUpdatesDropped = 0;  // Queue full, the strip shows an older state until the next change
+
+// Initialize ButtonHandler objects, the Start button and the homing switch belong to the station
 ButtonHandler buttonRotarySwitch(ROTARY_SW_PIN, "Rotary");
 
-// Initialize ESP32Encoder
-ESP32Encoder encoder;
+// Rotary encoder, read through PCNT events
+RotaryInput rotary;
+
+// Button and encoder events for the stations, produced once per loop pass
+InputBus inputBus;
+
+// Raw input levels and encoder movement since boot, exported over serial for host replays
+InputTrace inputTrace;
+
+// Commands on the serial port for inspecting a running machine, in every build
+SerialConsole console;
+const unsigned long SERIAL_BAUD = 460800;  // Same as monitor_speed in platformio.ini
 
 // Variables for encoder
 int32_t lastEncoderValue = 0;
@@ -72,67 +118,76 @@ void handleEncoderChange(int32_t newValue) {
 #define ADDRESSABLE_LED_PIN 4  // New pin for Addressable LED
 #define RELAY_PIN 14  // Relay control pin
 
-// Define direction constants
-#define DIRECTION_HOME 1
-#define DIRECTION_RUN 1
-#define DIRECTION_ZERO -1
-
-#define HOMING_DISTANCE 125.0 // Distance to move back after hitting the switch (in mm)
-
-#define HOMING_SPEED 1400.0 // Speed for homing movement
-#define MOVE_TO_ZERO_SPEED 3000.0 // Speed for moving to zero position after homing
-
-// Define system states
-enum SystemState {
-  STARTUP,
-  HOMING,
-  IDLE,
-  RUNNING,
-  RETURNING_TO_START,
-  ERROR,
-  SETTINGS_MENU,
-  PARKING  // New state
+// Initialize MatrixDisplay
+MatrixDisplay display(0x27, 16, 2);
+LcdLayout layout(display);
+
+// Initialize Settings
+Settings settings(display, rotary);
+
+// Last known position, kept across soft resets
+PositionStore positionStore;
+
+// Cooking stations, each with its own stepper, heater relay, homing switch and Start button.
+// Another station is one more entry in both arrays and a free set of pins.
+const uint8_t STATION_COUNT = 1;
+const Station::Pins STATION_PINS[STATION_COUNT] = {
+  {STEP_PIN, DIR_PIN, STEPPER_ENABLE_PIN, RELAY_PIN, HOMING_SWITCH_PIN, START_BUTTON_PIN, BUILTIN_LED_PIN}
+};
+Station stations[STATION_COUNT] = {
+  {0, STATION_PINS[0], settings}
 };
 
-// Global variable to track system state
-volatile SystemState currentSystemState = STARTUP;
-SystemState previousSystemState = STARTUP;
-bool stateJustChanged = true;
+// Interleaves the stations' state handlers with stepper polls
+StationScheduler scheduler(StationScheduler::STEP_LATENESS_BUDGET);
 
-// Error message
-String errorMessage = "";
+// Steps the carriages and checks endstops and heaters on core 1, above the loop
+MotionTask motionTask;
 
-// Timer variables
-Timer timer;
+// Published once per loop pass for readers in other tasks
+MachineSnapshotLock machineSnapshot;
 
-// Define motor states
-enum MotorState {
-  MOVING,
-  CHANGING_DIRECTION
-};
+// Boot phase timestamps
+BootProfiler bootProfiler;
 
-// Movement and stepper motor parameters
-const int STEPS_PER_REV = 1600;  // 200 * 8 (for 8 microstepping)
-const float DISTANCE_PER_REV = 8.0;  // 8mm per revolution (lead of ACME rod)
-int TOTAL_STEPS;
-const float ACCELERATION = 5000.0;  // Adjust for smooth acceleration
+// One-shot and periodic callbacks for the stations' timers, on one esp_timer
+TimerService timerService;
 
-// Define LCD update interval
-static unsigned long lastLCDUpdateTime = 0;
-const unsigned long LCD_UPDATE_INTERVAL = 250;  // 0.25 second in milliseconds
+// Subsystem ticks run by the loop, each at its own rate
+TaskTable loopTasks;
 
-// Initialize stepper
-AccelStepper stepper(AccelStepper::DRIVER, STEP_PIN, DIR_PIN);
+// Loop iteration budgets, stall guard and task watchdog
+DeadlineMonitor deadlineMonitor;
+const unsigned long LOOP_GUARD_TIMEOUT = 3000;  // ms without a check-in before the outputs are forced safe
+const uint32_t LOOP_WATCHDOG_TIMEOUT = 8;  // s without a check-in before the chip resets
 
-// Initialize MatrixDisplay
-MatrixDisplay display(0x27, 16, 2);
+// Heap and task stack usage
+MemoryMonitor memoryMonitor;
+const uint32_t NETWORK_TASK_STACK_SIZE = 4096;  // Bytes
 
-// Initialize Settings
-Settings settings(display, encoder);
+// Set by the network task once the access point, DNS and OTA are up
+volatile bool networkReady = false;
+
+// Remote commands over UDP on the access point
+RemoteControl remote;
+
+// Finished cooking cycles on LittleFS, written while no carriage moves
+CycleLog cycleLog;
+
+// Compressed firmware uploads, only accepted in OTA mode with every station stopped
+OtaUpdater otaUpdater;
+bool otaMode = false;
+const unsigned long OTA_PROGRESS_INTERVAL = 500;  // ms between progress updates on the display
 
-// Variables for state machine
-MotorState currentState = MOVING;
-const unsigned long DIRECTION_CHANGE_DELAY = 50; // 50ms delay when changing direction
+// Power saving while nothing happens, any input restores full power
+PowerPolicy powerPolicy;
+const unsigned long POWER_REDUCE_DELAY = 2000;     // ms without input before the CPU slows down
+const unsigned long LIGHT_SLEEP_DELAY = 30000;     // ms without input before light sleep in IDLE
+const unsigned long STEPPER_IDLE_TIMEOUT = 60000;  // ms without input before the stepper driver is released
+const unsigned long LIGHT_SLEEP_PERIOD = 100;      // Longest single light sleep in ms
+const uint8_t WAKEUP_PINS[] = {START_BUTTON_PIN, HOMING_SWITCH_PIN, ROTARY_CLK_PIN, ROTARY_DT_PIN, ROTARY_SW_PIN};
+volatile uint8_t apStationCount = 0;  // Stations connected to the access point
+bool wokeByInput = false;
 
 // Function to initialize and turn on LED strip
 void initializeLEDStrip() {
@@ -142,456 +197,651 @@ void initializeLEDStrip() {
   FastLED.show();
 }
 
-// Function to set LED strip to green (0, 255, 0)
-void setLEDGreen() {
-  fill_solid(leds, NUM_LEDS, CRGB(0, 255, 0));
-  FastLED.show();
+// Each station shows its state on its own share of the LED strip
+const uint8_t LEDS_PER_STATION = NUM_LEDS / STATION_COUNT;
+
+// Yellow while homing or returning, green when idle, red while cooking
+CRGB indicatorColour(Station::Indicator indicator) {
+  switch (indicator) {
+    case Station::INDICATOR_IDLE:
+      return CRGB(0, 255, 0);
+    case Station::INDICATOR_RUNNING:
+      return CRGB(255, 0, 0);
+    default:
+      return CRGB(216, 216, 0);
+  }
 }
 
-// Function to set LED strip to yellow (255, 255, 0)
-void setLEDYellow() {
-  fill_solid(leds, NUM_LEDS, CRGB(216, 216, 0));
-  FastLED.show();
+// Draws queued changes, several at once with a single show() when they pile up
+void ledTaskFunction(void*) {
+  LedUpdate update;
+  while (true) {
+    xQueueReceive(ledQueue, &update, portMAX_DELAY);
+    do {
+      if (update.station < STATION_COUNT) {
+        fill_solid(leds + update.station * LEDS_PER_STATION, LEDS_PER_STATION, indicatorColour(update.indicator));
+      }
+    } while (xQueueReceive(ledQueue, &update, 0) == pdTRUE);
+    FastLED.show();
+  }
 }
 
-// Function to set LED strip to red (255, 0, 0)
-void setLEDRed() {
-  fill_solid(leds, NUM_LEDS, CRGB(255, 0, 0));
-  FastLED.show();
+// Later changes go through the LED task on core 0, next to the display task
+void startLedTask() {
+  ledQueue = xQueueCreateStatic(LED_QUEUE_LENGTH, sizeof(LedUpdate), ledQueueStorage, &ledQueueBuffer);
+  ledTask = xTaskCreateStaticPinnedToCore(ledTaskFunction, "Leds", LED_TASK_STACK_SIZE, NULL, 1, ledTaskStack, &ledTaskBuffer, 0);
 }
 
-void startHeater() {
-  digitalWrite(RELAY_PIN, HIGH);
-  digitalWrite(BUILTIN_LED_PIN, HIGH);
-}
+// Called by the stations from the control loop, only queues the change
+void setStationLEDs(uint8_t station, Station::Indicator indicator) {
+  LedUpdate update = {station, indicator};
+  if (ledQueue == NULL || xQueueSend(ledQueue, &update, 0) != pdTRUE) {
+    ledUpdatesDropped++;
+  }
 
-void stopHeater() {
-  digitalWrite(RELAY_PIN, LOW);
-  digitalWrite(BUILTIN_LED_PIN, LOW);
+  // The first station reaching homing ends the boot sequence
+  static bool homingMarked = false;
+  if (!homingMarked && station == 0 && indicator == Station::INDICATOR_HOMING) {
+    homingMarked = true;
+    bootProfiler.mark("homing");
+  }
 }
 
-// Function to enter Settings menu
-void enterSettingsMenu() {
-  settings.enter();  // Enter settings menu
+// Called from the deadline guard when the loop stalls, so it only touches the pins
+void forceSafeOutputs() {
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    stations[i].forceSafeOutputs();
+  }
 }
 
-// Function to exit Settings menu
-void exitSettingsMenu() {
-  settings.exit();  // Exit settings menu
+// Sends every station to ERROR that is not there already, true if any was
+bool failStations(const char* message, unsigned long currentTime) {
+  bool failed = false;
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    if (stations[i].getState() != ERROR) {
+      stations[i].fail(message, currentTime);
+      failed = true;
+    }
+  }
+  return failed;
 }
 
-// Global variables for timing
-unsigned long stateStartTime = 0;
-const unsigned long WELCOME_DURATION = 1000;  // 5 seconds
-const unsigned long HOMING_TIMEOUT = 30000;   // 30 seconds
+// Copies every station's status into the snapshot, the loop task is the only writer
+void publishSnapshot(unsigned long currentTime) {
+  static MachineSnapshot snapshot;
+  snapshot.iteration++;
+  snapshot.time = currentTime;
+  snapshot.stationCount = STATION_COUNT;
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    stations[i].getStatus(snapshot.stations[i]);
+  }
+  machineSnapshot.write(snapshot);
+}
 
-// Function to convert SystemState to string
-const char* getStateName(SystemState state) {
-  switch(state) {
-    case STARTUP: return "STARTUP";
-    case HOMING: return "HOMING";
-    case IDLE: return "IDLE";
-    case RUNNING: return "RUNNING";
-    case RETURNING_TO_START: return "RETURNING_TO_START";
-    case ERROR: return "ERROR";
-    case SETTINGS_MENU: return "SETTINGS_MENU";
-    case PARKING: return "PARKING";
-    default: return "UNKNOWN";
+// True while any station steps its carriage
+bool stationsMoving() {
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    if (stations[i].isMoving()) {
+      return true;
+    }
   }
+  return false;
 }
 
-// New function to handle state changes
-void changeState(SystemState newState, unsigned long currentTime = 0) {
-  previousSystemState = currentSystemState;
-  currentSystemState = newState;
-  stateStartTime = currentTime == 0 ? millis() : currentTime;
-  stateJustChanged = true;
+// Queues a finished cycle for the log, the write happens later from the loop
+void logCycle(const CycleLog::Record& record) {
+  cycleLog.append(record, millis());
 }
 
-void handleStartup(unsigned long currentTime) {
-  if (stateJustChanged) {
-    display.updateDisplay("OrangeMakers", "Marshmallow 2.0");
-    stateJustChanged = false;
+// State that picks the loop budget and power profile: the first station
+// moving the carriage, else the first one not idle, else IDLE
+SystemState activeState() {
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    SystemState state = stations[i].getState();
+    if (state == HOMING || state == RUNNING || state == RETURNING_TO_START || state == PARKING) {
+      return state;
+    }
   }
-
-  if (currentTime - stateStartTime >= WELCOME_DURATION) {
-    changeState(HOMING, currentTime);
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    if (stations[i].getState() != IDLE) {
+      return stations[i].getState();
+    }
   }
+  return IDLE;
 }
 
-static unsigned long lastHomingUpdateTime = 0;
-
-void handleHoming(unsigned long currentTime) {
-  static bool waitingForConfirmation = true;
-  static long homingSteps = 0;
-  static bool homingStarted = false;
-  static bool movingAwayFromSwitch = false;
-
-  if (stateJustChanged) {
-    waitingForConfirmation = true;
-    homingStarted = false;
-    movingAwayFromSwitch = false;
-    display.updateDisplay("To start homing", "press rotary");
-    stateJustChanged = false;
-    lastHomingUpdateTime = 0; // Reset the update time when state changes
-    setLEDYellow(); // Set LED to yellow when homing begins
-  }
+// Kept up to date from the Wi-Fi event task
+void updateStationCount(arduino_event_id_t, arduino_event_info_t) {
+  apStationCount = WiFi.softAPgetStationNum();
+}
 
-  if (waitingForConfirmation) {
-    if (buttonRotarySwitch.isPressed()) {
-      waitingForConfirmation = false;
-      homingStarted = true;
-      stateStartTime = currentTime;  // Reset the start time for homing
-      digitalWrite(STEPPER_ENABLE_PIN, LOW);  // Enable the stepper motor
-      stepper.setMaxSpeed(HOMING_SPEED);
-      stepper.setAcceleration(ACCELERATION * 2);  // Set higher acceleration for more instant stop during homing
-      homingSteps = DIRECTION_HOME * 1000000;  // Large number to ensure continuous movement
-      stepper.moveTo(homingSteps);
-      display.updateDisplay("Homing:", "In progress");
-    }
-  } else if (homingStarted && !movingAwayFromSwitch) {
-    if (buttonLimitSwitch.getState()) {
-      display.updateDisplay("Homing:", "Triggered");
-      stepper.stop();  // Stop as fast as possible: sets new target
-      stepper.runToPosition();  // Wait for the stepper to stop
-      
-      // Wait for 1 second
-      delay(1000);
-      
-      stepper.setMaxSpeed(MOVE_TO_ZERO_SPEED);
-      stepper.setAcceleration(ACCELERATION);  // Restore original acceleration
-      homingSteps = DIRECTION_ZERO * (HOMING_DISTANCE / DISTANCE_PER_REV) * STEPS_PER_REV;  // Move HOMING_DISTANCE in run direction
-      stepper.move(homingSteps);
-      movingAwayFromSwitch = true;
-      display.updateDisplay("Homing:", "Move to Zero");
-    } else if (currentTime - stateStartTime > HOMING_TIMEOUT) {
-      // Homing timeout
-      errorMessage = "Homing failed";
-      changeState(ERROR, currentTime);
-      return;
-    } else {
-      stepper.run();
-    }
-  } else if (movingAwayFromSwitch) {
-    if (stepper.distanceToGo() == 0) {
-      // Finished moving away from switch
-      stepper.setCurrentPosition(0);
-      stepper.setMaxSpeed(settings.getSpeed());  // Restore original max speed
-      #ifdef DEBUG
-      Serial.println("Homing completed!");
-      #endif
-      display.updateDisplay("Homing:", "Completed", 2000);
-      changeState(IDLE, currentTime);
-    } else {
-      stepper.run();
+// Hands every queued input event to the station it belongs to
+void handleInputEvents(unsigned long currentTime) {
+  InputEvent event;
+  while (inputBus.next(event)) {
+    if (event.station < STATION_COUNT) {
+      stations[event.station].handleEvent(event, currentTime);
     }
   }
 }
 
-void handleIdle() {
-  const unsigned long LONG_PRESS_DURATION = 5000; // 5 seconds for long press
-  const unsigned long SETTINGS_PRESS_DURATION = 1000; // 1 second for settings
+// Applies the power policy, a change only costs time on the pass where it happens
+void applyPowerPolicy(unsigned long currentTime) {
+  static uint32_t appliedCpuMhz = PowerPolicy::FULL_CPU_MHZ;
+  static bool radioLowPower = false;
+  static bool stepperReleased = false;
 
-  if (stateJustChanged) {
-    display.updateDisplay("Idle..", "Press Start");
-    stateJustChanged = false;
-    setLEDGreen(); // Set LED to green when idle
-  }
+  powerPolicy.update(activeState(), inputBus.takeActivity() || wokeByInput, apStationCount > 0, currentTime);
+  wokeByInput = false;
 
-  static bool startButtonWasPressed = false;
-  static unsigned long startPressStartTime = 0;
+  if (powerPolicy.getCpuMhz() != appliedCpuMhz) {
+    appliedCpuMhz = powerPolicy.getCpuMhz();
+    setCpuFrequencyMhz(appliedCpuMhz);
+  }
 
-  if (buttonStart.isPressed()) {
-    startButtonWasPressed = true;
-    startPressStartTime = millis();
+  // The access point does not support modem sleep, so lower the transmit power instead
+  if (networkReady && powerPolicy.isRadioLowPower() != radioLowPower) {
+    radioLowPower = powerPolicy.isRadioLowPower();
+    WiFi.setTxPower(radioLowPower ? WIFI_POWER_8_5dBm : WIFI_POWER_19_5dBm);
   }
 
-  if (startButtonWasPressed) {
-    unsigned long pressDuration = millis() - startPressStartTime;
-    if (pressDuration >= LONG_PRESS_DURATION) {
-      changeState(PARKING, millis());
-      startButtonWasPressed = false;
-    } else if (buttonStart.isReleased()) {
-      changeState(RUNNING, millis());
-      timer.start(settings.getCookTime());
-      TOTAL_STEPS = (settings.getTotalDistance() / DISTANCE_PER_REV) * STEPS_PER_REV;
-      stepper.moveTo(DIRECTION_RUN * TOTAL_STEPS);
-      startButtonWasPressed = false;
+  if (powerPolicy.isStepperIdle() != stepperReleased) {
+    stepperReleased = powerPolicy.isStepperIdle();
+    for (uint8_t i = 0; i < STATION_COUNT; i++) {
+      stations[i].releaseDriver(stepperReleased);
     }
   }
+}
 
-  if (buttonRotarySwitch.isPressedForMs() >= SETTINGS_PRESS_DURATION) {
-    changeState(SETTINGS_MENU, millis());
-    enterSettingsMenu();
+// Sleeps until the timeout or a level change on any input pin, true when an input woke it
+bool lightSleep(unsigned long duration) {
+  for (uint8_t pin : WAKEUP_PINS) {
+    gpio_wakeup_enable((gpio_num_t)pin, digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
   }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(duration * 1000);
+  esp_light_sleep_start();
+  for (uint8_t pin : WAKEUP_PINS) {
+    gpio_wakeup_disable((gpio_num_t)pin);
+  }
+  deadlineMonitor.discardIteration();  // The sleep is not loop work
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+}
 
-  stepper.stop();
+#ifdef DEBUG
+const unsigned long DEBUG_PRINT_PERIOD = 1000;  // ms
+
+// Function to dump switch states and encoder value, a loop task every DEBUG_PRINT_PERIOD
+void dumpDebug(unsigned long currentTime) {
+    Serial.print("State:");
+    Serial.print(Station::getStateName(stations[0].getState()));
+    Serial.print(" Rotary:");
+    Serial.print(buttonRotarySwitch.getState());
+    Serial.print(" Encoder:");
+    Serial.print(encoderValue);
+    Serial.print(" Direction:");
+    Serial.print(encoderValue > lastEncoderValue ? "CW" : (encoderValue < lastEncoderValue ? "CCW" : "No change"));
+    Serial.print(" CookTime:");
+    Serial.print(settings.getCookTime().value());
+    Serial.print(" Speed:");
+    Serial.print(settings.getSpeed().value());
+    Serial.print(" TotalDistance:");
+    Serial.print(settings.getTotalDistance().value());
+    Serial.print(" CPU:");
+    Serial.print(getCpuFrequencyMhz());
+    Serial.print("MHz Clients:");
+    Serial.print(apStationCount);
+    Serial.print(" DNS:");
+    Serial.print(captiveDns.getQueryCount());
+    Serial.print(" StepLate:");
+    Serial.print(scheduler.getWorstStepLateness());
+    MotionTask::Stats motionStats;
+    motionTask.getStats(motionStats);
+    Serial.print("us Jitter:");
+    Serial.print(motionStats.worstJitter);
+    Serial.print("us Missed:");
+    Serial.print(motionStats.missedTicks);
+    Serial.print(" Underruns:");
+    Serial.print(scheduler.getStepUnderruns());
+    Serial.print(" LedDrop:");
+    Serial.println(ledUpdatesDropped);
+
+    // Report loop deadlines whenever new overruns have been counted
+    static uint32_t reportedOverruns = 0;
+    if (deadlineMonitor.getTotalOverruns() != reportedOverruns) {
+      reportedOverruns = deadlineMonitor.getTotalOverruns();
+      deadlineMonitor.report(Serial, Station::getStateName);
+    }
+
+    // Same for the loop tasks
+    static uint32_t reportedTaskOverruns = 0;
+    if (loopTasks.getTotalOverruns() != reportedTaskOverruns) {
+      reportedTaskOverruns = loopTasks.getTotalOverruns();
+      loopTasks.report(Serial);
+    }
+
+    // Memory report every 30 seconds
+    static unsigned long lastMemoryReport = 0;
+    if (currentTime - lastMemoryReport > 30000) {
+        memoryMonitor.report(Serial);
+        lastMemoryReport = currentTime;
+    }
 }
+#endif
 
-void handleRunning(unsigned long currentTime) {
+// Function to display current settings
+#ifdef DEBUG
+void displayCurrentSettings() {
+  Serial.println("Current Settings:");
+  Serial.print("Cook Time: ");
+  Serial.print(settings.getCookTime().value());
+  Serial.println(" ms");
+  Serial.print("Total Distance: ");
+  Serial.print(settings.getTotalDistance().value());
+  Serial.println(" mm");
+  Serial.print("Speed: ");
+  Serial.print(settings.getSpeed().value());
+  Serial.println(" steps/second");
+}
+#endif
 
-  if (stateJustChanged) {
-    stateJustChanged = false;
-    display.updateDisplay("Cooking", "Started");
-    timer.start(settings.getCookTime());
-    currentState = MOVING;  // Ensure we start in the MOVING state
-    TOTAL_STEPS = (settings.getTotalDistance() / DISTANCE_PER_REV) * STEPS_PER_REV;
-    stepper.setMaxSpeed(settings.getSpeed());  // Set the correct max speed
-    stepper.moveTo(DIRECTION_RUN * TOTAL_STEPS);  // Set initial movement direction
-    lastLCDUpdateTime = 0; // Force an immediate update
-    startHeater(); // Start the heater when entering the running state
-    setLEDRed(); // Set LED to red when running
-  }
+// Stops every station and hands the loop to the firmware transfer until the restart
+void enterOtaMode(unsigned long currentTime) {
+  forceSafeOutputs();
+  failStations("OTA update", currentTime);
+  cycleLog.flush();  // Keep the cycles cut short by the update
 
-  if (buttonStart.isPressed()) {
-    stopHeater(); // Stop the heater
-    changeState(RETURNING_TO_START, currentTime);
-    display.updateDisplay("Cooking", "Aborted");
-    stepper.moveTo(0);  // Set target to start position
-    timer.stop();
-    return;
-  }
+  // Nothing else runs now, so spend everything on the transfer
+  setCpuFrequencyMhz(PowerPolicy::FULL_CPU_MHZ);
+  WiFi.setTxPower(WIFI_POWER_19_5dBm);
 
-  if (timer.hasExpired()) {
-    stopHeater(); // Stop the heater
-    changeState(RETURNING_TO_START, currentTime);
-    display.updateDisplay("Cooking", "Done");
-    stepper.moveTo(0);  // Set target to start position
-    timer.stop();
-    return;
-  }
+  otaUpdater.begin(ota_password);
+  display.updateDisplay("OTA mode", "Waiting...");
+  otaMode = true;
+}
 
-  // Check if homing switch is triggered
-  if (buttonLimitSwitch.getState()) {
-    stopHeater(); // Stop the heater
-    changeState(ERROR, currentTime);
-    errorMessage = "Endstop trigger";
-    return;
+void showOtaProgress(uint32_t written, uint32_t total) {
+  static unsigned long lastUpdate = 0;
+  deadlineMonitor.checkIn();
+  if (millis() - lastUpdate < OTA_PROGRESS_INTERVAL && written < total) return;
+  lastUpdate = millis();
+
+  char row2[MatrixDisplay::MAX_COLS + 1];
+  snprintf(row2, sizeof(row2), "%lu%%", static_cast<unsigned long>(total > 0 ? 100ULL * written / total : 0));
+  display.updateDisplay("OTA updating", row2);
+}
+
+// The loop in OTA mode: both upload paths and nothing else
+void handleOtaMode() {
+  ArduinoOTA.handle();
+  OtaUpdater::Result result = otaUpdater.poll(showOtaProgress);
+  if (result == OtaUpdater::RESULT_OK) {
+    display.updateDisplay("OTA done", "Restarting");
+    delay(500);  // Let the display task draw the message
+    ESP.restart();
+  } else if (result == OtaUpdater::RESULT_FAILED) {
+    display.updateDisplay("OTA failed", otaUpdater.getError());
+    #ifdef DEBUG
+    Serial.print("OTA failed: ");
+    Serial.println(otaUpdater.getError());
+    #endif
   }
+}
 
-  switch (currentState) {
-    case MOVING:
-      if (stepper.distanceToGo() == 0) {
-        // Change direction when reaching either end
-        TOTAL_STEPS = (settings.getTotalDistance() / DISTANCE_PER_REV) * STEPS_PER_REV;
-        stepper.moveTo(stepper.currentPosition() == 0 ? DIRECTION_RUN * TOTAL_STEPS : (stepper.currentPosition() == DIRECTION_RUN * TOTAL_STEPS ? 0 : DIRECTION_RUN * TOTAL_STEPS));
-        currentState = CHANGING_DIRECTION;
-        stateStartTime = currentTime;
-      } else {
-        stepper.run();
+// Answers queued remote requests for the first station. Actions are accepted in the same states as the buttons allow them.
+void handleRemoteRequests(unsigned long currentTime) {
+  Station& station = stations[0];
+  RemoteControl::Request request;
+  while (remote.nextRequest(request)) {
+    switch (request.command) {
+      case RemoteControl::CMD_START:
+        remote.reply(request, station.start() ? RemoteControl::STATUS_OK : RemoteControl::STATUS_REJECTED);
+        break;
+
+      case RemoteControl::CMD_ABORT:
+        remote.reply(request, station.abort(currentTime) ? RemoteControl::STATUS_OK : RemoteControl::STATUS_REJECTED);
+        break;
+
+      case RemoteControl::CMD_PARK:
+        remote.reply(request, station.park() ? RemoteControl::STATUS_OK : RemoteControl::STATUS_REJECTED);
+        break;
+
+      case RemoteControl::CMD_GET_STATUS:
+        remote.replyStatus(request, station.getState(), station.isHeaterOn(), station.getRemainingTime(),
+                           station.getPosition());
+        break;
+
+      case RemoteControl::CMD_GET_SETTINGS:
+        remote.replySettings(request, settings.getCookTime().value(), lroundf(settings.getTotalDistance().value() * 1000.0f),
+                             lroundf(settings.getSpeed().value()));
+        break;
+
+      case RemoteControl::CMD_SET_SETTING:
+        // Only while every station is idle, so a cook in progress and an open menu keep the values they started with
+        if (activeState() != IDLE) {
+          remote.reply(request, RemoteControl::STATUS_REJECTED);
+          break;
+        }
+        if (request.setting == RemoteControl::SETTING_COOK_TIME) {
+          settings.setCookTime(Millis(request.value < 0 ? 0 : request.value));
+          remote.replyValue(request, RemoteControl::STATUS_OK, settings.getCookTime().value());
+        } else if (request.setting == RemoteControl::SETTING_TOTAL_DISTANCE) {
+          settings.setTotalDistance(Millimetres(request.value / 1000.0f));
+          remote.replyValue(request, RemoteControl::STATUS_OK, lroundf(settings.getTotalDistance().value() * 1000.0f));
+        } else {
+          settings.setSpeed(StepsPerSecond(request.value));
+          remote.replyValue(request, RemoteControl::STATUS_OK, lroundf(settings.getSpeed().value()));
+        }
+        break;
+
+      case RemoteControl::CMD_READ_LOG: {
+        // Flash reads stall the other core like writes do, so not while a carriage moves
+        if (stationsMoving()) {
+          remote.reply(request, RemoteControl::STATUS_REJECTED);
+          break;
+        }
+        uint8_t record[CycleLog::RECORD_SIZE];
+        bool found = cycleLog.readRecord(static_cast<uint32_t>(request.value), record);
+        remote.replyLogRecord(request, cycleLog.getRecordCount(), found ? record : NULL, sizeof(record));
+        break;
       }
-      break;
 
-    case CHANGING_DIRECTION:
-      if (currentTime - stateStartTime >= DIRECTION_CHANGE_DELAY) {
-        currentState = MOVING;
+      case RemoteControl::CMD_EXPORT_TRACE:
+        // Streams from the loop a few lines per pass, so it is also safe during a cook
+        if (inputTrace.startExport()) {
+          remote.replyValue(request, RemoteControl::STATUS_OK, inputTrace.getCount());
+        } else {
+          remote.reply(request, RemoteControl::STATUS_REJECTED);
+        }
+        break;
+
+      case RemoteControl::CMD_OTA_MODE: {
+        // Not during a cook or a move, which it would end in ERROR. A machine that is idle, in the menu or in
+        // ERROR can still be updated; the power has to be cycled to leave OTA mode without an update
+        SystemState state = activeState();
+        if (state == HOMING || state == RUNNING || state == RETURNING_TO_START || state == PARKING) {
+          remote.reply(request, RemoteControl::STATUS_REJECTED);
+          break;
+        }
+        remote.reply(request, RemoteControl::STATUS_OK);
+        enterOtaMode(currentTime);
+        break;
       }
-      break;
+    }
   }
+}
+
+// Console commands. They print into the console's buffer and return, anything that takes longer runs from the loop.
 
-  // Update LCD with remaining time and distance at specified interval
-  if (currentTime - lastLCDUpdateTime >= LCD_UPDATE_INTERVAL) {
-    unsigned long remainingTime = timer.getRemainingTime() / 1000; // Convert to seconds
-    float distance = abs(stepper.currentPosition() * DISTANCE_PER_REV / STEPS_PER_REV);
-    
-    String timeStr = "Time: " + String(remainingTime) + "s";
-    String distStr = "Dist: " + String(distance, 1) + "mm";
-    display.updateDisplay(timeStr, distStr);
-    
-    lastLCDUpdateTime = currentTime;
+// Station from a console argument, the first one when there is none
+bool consoleStation(Print& out, const char* args, uint8_t& index) {
+  index = args[0] == '\0' ? 0 : atoi(args);
+  if (index >= STATION_COUNT) {
+    out.printf("No station %s\n", args);
+    return false;
   }
+  return true;
 }
 
-void handleReturningToStart() {
-  unsigned long currentTime = millis();
+void consoleHelp(Print& out, const char*, unsigned long) {
+  console.printHelp(out);
+}
 
-  if (stateJustChanged) {
-    stateJustChanged = false;
-    stepper.setMaxSpeed(settings.getSpeed());  // Set the correct max speed
-    lastLCDUpdateTime = 0; // Force an immediate update
-    stopHeater(); // Stop the heater when returning to start
-    setLEDYellow(); // Set LED to yellow when returning to start
+void consoleState(Print& out, const char*, unsigned long currentTime) {
+  out.printf("Uptime %lu ms, CPU %lu MHz, %u clients, network %s%s\n", currentTime,
+             static_cast<unsigned long>(getCpuFrequencyMhz()), apStationCount, networkReady ? "up" : "starting",
+             otaMode ? ", OTA mode" : "");
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    Station::Status status;
+    stations[i].getStatus(status);
+    out.printf("Station %u: %s, heater %s%s, %lu ms left%s%s\n", i, Station::getStateName(status.state),
+               status.heaterOn ? "on" : "off", status.moving ? ", moving" : "",
+               static_cast<unsigned long>(status.remainingTime), status.error[0] != '\0' ? ", last error: " : "",
+               status.error);
   }
+}
 
-  if (stepper.distanceToGo() == 0) {
-    // We've reached the start position
-    changeState(IDLE, currentTime);
-    display.updateDisplay("Returned to", "Start Position");
+void consoleSettings(Print& out, const char*, unsigned long) {
+  out.printf("Cook time %lu ms, total distance %.3f mm, speed %.0f steps/s, %ld steps per stroke\n",
+             static_cast<unsigned long>(settings.getCookTime().value()), settings.getTotalDistance().value(),
+             settings.getSpeed().value(), static_cast<long>(settings.getTotalSteps().value()));
+}
+
+void consolePosition(Print& out, const char*, unsigned long) {
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    Station::Status status;
+    stations[i].getStatus(status);
+    out.printf("Station %u: at %ld steps, target %ld\n", i, static_cast<long>(status.position),
+               static_cast<long>(status.target));
+  }
+  if (positionStore.hasValidPosition()) {
+    out.printf("Stored position %ld steps\n", positionStore.getPosition());
   } else {
-    stepper.run();
-
-    if (currentTime - lastLCDUpdateTime >= LCD_UPDATE_INTERVAL) {
-      float distance = abs(stepper.currentPosition() * DISTANCE_PER_REV / STEPS_PER_REV);
-      String returnStr = "Returning";
-      String distStr = "Dist: " + String(distance, 1) + "mm";
-      display.updateDisplay(returnStr, distStr);
-      lastLCDUpdateTime = currentTime;
-    }
+    out.println("No stored position");
   }
 }
 
-void handleError() {
-  if (stateJustChanged) {
-    // Set STEPPER_ENABLE_PIN to HIGH to disable the stepper driver
-    digitalWrite(STEPPER_ENABLE_PIN, HIGH);
-    stopHeater(); // Stop the heater in case of an error
-    stateJustChanged = false;
+void consoleTimers(Print& out, const char*, unsigned long) {
+  out.printf("Timers: %u of %u in use, motion timer %s\n", timerService.getTimerCount(), TimerService::MAX_TIMERS,
+             motionTask.isRunning() ? "running" : "stopped");
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    out.printf("Station %u: %lu ms of cook time left\n", i, stations[i].getRemainingTime());
   }
-  
-  // Always display the error message
-  display.updateDisplay("Error", errorMessage);
+}
 
-  // In ERROR state, we don't do anything else until the device is reset
+void consoleMemory(Print& out, const char*, unsigned long) {
+  memoryMonitor.report(out);
 }
 
-#ifdef DEBUG
-// Function to dump switch states and encoder value
-static unsigned long lastDebugPrint = 0;
-void dumpDebug() {
-    unsigned long currentTime = millis();
-
-    // Debug print every second
-    if (currentTime - lastDebugPrint > 1000) {
-        Serial.print("Start:");
-        Serial.print(buttonStart.getState());
-        Serial.print(" Limit:");
-        Serial.print(buttonLimitSwitch.getState());
-        Serial.print(" Rotary:");
-        Serial.print(buttonRotarySwitch.getState());
-        Serial.print(" Encoder:");
-        Serial.print(encoderValue);
-        Serial.print(" Direction:");
-        Serial.print(encoderValue > lastEncoderValue ? "CW" : (encoderValue < lastEncoderValue ? "CCW" : "No change"));
-        Serial.print(" CookTime:");
-        Serial.print(settings.getCookTime());
-        Serial.print(" Speed:");
-        Serial.print(settings.getSpeed());
-        Serial.print(" TotalDistance:");
-        Serial.println(settings.getTotalDistance());
-        lastDebugPrint = currentTime;
-    }
+void consoleBoot(Print& out, const char*, unsigned long) {
+  bootProfiler.report(out);
 }
-#endif
 
-// Function to display current settings
-#ifdef DEBUG
-void displayCurrentSettings() {
-  Serial.println("Current Settings:");
-  Serial.print("Cook Time: ");
-  Serial.print(settings.getCookTime());
-  Serial.println(" ms");
-  Serial.print("Total Distance: ");
-  Serial.print(settings.getTotalDistance());
-  Serial.println(" mm");
-  Serial.print("Speed: ");
-  Serial.print(settings.getSpeed());
-  Serial.println(" steps/second");
+// Everything the loop and the motion task count, since boot or the last bench
+void printLoopStats(Print& out) {
+  deadlineMonitor.report(out, Station::getStateName);
+  loopTasks.report(out);
+  out.printf("Scheduler: %lu passes, worst %lu us, %lu over budget, worst step lateness %lu us, %lu step queue underruns\n",
+             static_cast<unsigned long>(scheduler.getPasses()), static_cast<unsigned long>(scheduler.getWorstPass()),
+             static_cast<unsigned long>(scheduler.getOverBudgetPasses()),
+             static_cast<unsigned long>(scheduler.getWorstStepLateness()),
+             static_cast<unsigned long>(scheduler.getStepUnderruns()));
+  MotionTask::Stats motionStats;
+  motionTask.getStats(motionStats);
+  out.printf("Motion: %lu refills, %lu missed, %lu skipped busy, jitter worst %lu / mean %lu us, worst refill %lu us\n",
+             static_cast<unsigned long>(motionStats.ticks), static_cast<unsigned long>(motionStats.missedTicks),
+             static_cast<unsigned long>(motionStats.busyStations), static_cast<unsigned long>(motionStats.worstJitter),
+             static_cast<unsigned long>(motionStats.meanJitter), static_cast<unsigned long>(motionStats.worstDuration));
+  out.printf("Motion interrupts: %lu, worst %lu us\n", static_cast<unsigned long>(motionStats.interrupts),
+             static_cast<unsigned long>(motionStats.worstInterrupt));
+  out.printf("LED updates dropped %lu, console bytes dropped %lu\n", static_cast<unsigned long>(ledUpdatesDropped),
+             static_cast<unsigned long>(console.getDroppedBytes()));
 }
-#endif
 
-void handleParking() {
-  static bool parkingStarted = false;
-
-  if (stateJustChanged) {
-    stateJustChanged = false;
-    parkingStarted = false;
-    display.updateDisplay("Parking", "Please wait");
-    digitalWrite(STEPPER_ENABLE_PIN, LOW);  // Enable the stepper motor
-    stepper.setMaxSpeed(settings.getSpeed());
-    stepper.setAcceleration(ACCELERATION);
-    float parkDistance = 120.0;  // 120mm parking distance
-    long parkSteps = (parkDistance / DISTANCE_PER_REV) * STEPS_PER_REV;
-    stepper.moveTo(DIRECTION_HOME * parkSteps);
-    parkingStarted = true;
-  }
-
-  if (parkingStarted) {
-    if (stepper.distanceToGo() == 0) {
-      // Parking completed
-      digitalWrite(STEPPER_ENABLE_PIN, HIGH);  // Disable the stepper motor
-      display.updateDisplay("Please turn off", "The power");
-      while (true) {
-        // Infinite loop to stop all processing
-        delay(1000);
-      }
-    } else {
-      stepper.run();
-    }
-  }
+void consoleLoop(Print& out, const char*, unsigned long) {
+  printLoopStats(out);
 }
 
-void setup() {
-  settings.loadSettingsFromPreferences();
+// Profiles the machine as it runs: clears the loop and motion statistics and reports them after a window
+const unsigned long BENCH_DEFAULT_WINDOW = 10;  // s
+const unsigned long BENCH_MAX_WINDOW = 600;     // s
+unsigned long benchStart = 0;
+unsigned long benchWindow = 0;  // ms, 0 while no bench runs
 
-  // Initialize LED strip
-  initializeLEDStrip();
+void consoleBench(Print& out, const char* args, unsigned long currentTime) {
+  unsigned long window = args[0] == '\0' ? BENCH_DEFAULT_WINDOW : strtoul(args, NULL, 10);
+  if (window == 0 || window > BENCH_MAX_WINDOW) {
+    out.printf("Window must be 1 to %lu s\n", BENCH_MAX_WINDOW);
+    return;
+  }
+  deadlineMonitor.resetStats();
+  loopTasks.resetStats();
+  scheduler.resetStats();
+  motionTask.resetStats();
+  benchStart = currentTime;
+  benchWindow = window * 1000;
+  out.printf("Profiling for %lu s\n", window);
+}
 
-  #ifdef DEBUG
-  Serial.begin(115200);  // Initialize serial communication
-  
-  // Print initial settings
-  displayCurrentSettings();
-  #endif
+// Reports a finished bench window, from the console task
+void finishBench(unsigned long currentTime) {
+  if (benchWindow == 0 || currentTime - benchStart < benchWindow) return;
+  console.printf("Bench over %lu ms:\n", currentTime - benchStart);
+  printLoopStats(console);
+  benchWindow = 0;
+}
 
-  // Initialize pins
-  pinMode(BUILTIN_LED_PIN, OUTPUT);
-  pinMode(ADDRESSABLE_LED_PIN, OUTPUT);
-  pinMode(STEP_PIN, OUTPUT);
-  pinMode(DIR_PIN, OUTPUT);
-  pinMode(STEPPER_ENABLE_PIN, OUTPUT);
-  digitalWrite(STEPPER_ENABLE_PIN, HIGH);  // Set STEPPER_ENABLE_PIN to HIGH by default
-  pinMode(RELAY_PIN, OUTPUT);
-  digitalWrite(RELAY_PIN, LOW);  // Set RELAY_PIN to LOW by default
+// The same actions as the remote commands, accepted in the same states
+void consoleAbort(Print& out, const char* args, unsigned long currentTime) {
+  uint8_t index;
+  if (!consoleStation(out, args, index)) return;
+  bool accepted = stations[index].abort(currentTime);
+  out.printf("%s\n", accepted ? "Aborted" : "Rejected");
+}
 
-  // Rotary Encoder
-  pinMode(ROTARY_CLK_PIN, INPUT_PULLUP);
-  pinMode(ROTARY_DT_PIN, INPUT_PULLUP);
-  pinMode(ROTARY_SW_PIN, INPUT_PULLUP);
+void consolePark(Print& out, const char* args, unsigned long) {
+  uint8_t index;
+  if (!consoleStation(out, args, index)) return;
+  bool accepted = stations[index].park();
+  out.printf("%s\n", accepted ? "Parking" : "Rejected");
+}
 
-  // Initialize ButtonHandler objects
-  buttonStart.begin();
-  buttonLimitSwitch.begin();
-  buttonRotarySwitch.begin();
+void consoleTrace(Print& out, const char*, unsigned long) {
+  if (inputTrace.startExport()) {
+    out.printf("Exporting %u input trace records\n", inputTrace.getCount());
+  } else {
+    out.println("Export already running");
+  }
+}
 
-  // Initialize ESP32Encoder
-  ESP32Encoder::useInternalWeakPullResistors=UP;
-  encoder.attachHalfQuad(ROTARY_CLK_PIN, ROTARY_DT_PIN);
-  encoder.setCount(0);
+void addConsoleCommands() {
+  console.addCommand("help", "List the commands", consoleHelp);
+  console.addCommand("state", "Station states, heaters, cook time left, CPU and network", consoleState);
+  console.addCommand("settings", "Cook time, distance and speed", consoleSettings);
+  console.addCommand("position", "Carriage positions and the stored position", consolePosition);
+  console.addCommand("timers", "Timers in use and cook time left", consoleTimers);
+  console.addCommand("boot", "Boot phase timestamps, up to the start of homing", consoleBoot);
+  console.addCommand("memory", "Heap and task stacks", consoleMemory);
+  console.addCommand("loop", "Loop deadlines, loop tasks, scheduler and motion timing", consoleLoop);
+  console.addCommand("bench", "[s] Clear the timing stats and report them after s seconds", consoleBench);
+  console.addCommand("abort", "[station] Abort the cook", consoleAbort);
+  console.addCommand("park", "[station] Park the carriage", consolePark);
+  console.addCommand("trace", "Export the input trace", consoleTrace);
+}
 
-  // Initialize LCD
-  display.begin();
+// Loop task periods in ms, the budgets in addLoopTasks() are in microseconds
+const unsigned long INPUT_PERIOD = 5;          // Well inside the 50 ms debounce
+const unsigned long REMOTE_PERIOD = 10;
+const unsigned long POWER_PERIOD = 5;          // With the inputs, so a press and the power it brings back share a pass
+const unsigned long SNAPSHOT_PERIOD = 10;
+const unsigned long CYCLE_LOG_PERIOD = 100;
+const unsigned long TRACE_EXPORT_PERIOD = 5;   // A FIFO's worth at most, which the UART sends in under 3 ms
+const unsigned long CONSOLE_PERIOD = 5;
+
+// Button and encoder events, each handled once by the state its station is in.
+// The trace sees the levels this poll is about to read.
+void pollInputs(unsigned long currentTime) {
+  inputTrace.sample();
+  inputBus.poll(currentTime);
+  handleInputEvents(currentTime);
+
+  // Log encoder movement, the settings menu gets it through the input bus
+  #ifdef DEBUG
+  encoderValue = rotary.getCount();
+  if (encoderValue != lastEncoderValue) {
+    handleEncoderChange(encoderValue);
+  }
+  #endif
+}
 
-  // Configure stepper
-  stepper.setMaxSpeed(settings.getSpeed());
-  stepper.setAcceleration(ACCELERATION);
-  stepper.moveTo(0);  // Start at home position
+// Remote commands next, so the power policy sees a state they change
+void pollRemote(unsigned long currentTime) {
+  if (networkReady) {
+    remote.poll();
+  }
+  handleRemoteRequests(currentTime);
+}
 
-  // Initialize and start MatrixDisplay update thread
-  display.begin();
-  display.startUpdateThread();
+// State handlers, and the stepper polls when no motion task runs; every pass
+void serviceStations(unsigned long currentTime) {
+  scheduler.service(currentTime);
 
-  // Initialize state
-  changeState(STARTUP, millis());
+  // The motion timer only runs while a carriage moves, so light sleep and idle passes stay quiet
+  motionTask.setRunning(stationsMoving());
+}
 
-  // Set up Access Point
-  WiFi.mode(WIFI_AP);
-  WiFi.softAP(ap_ssid, ap_password);
+// Batched log writes, only while no carriage moves
+void serviceCycleLog(unsigned long currentTime) {
+  cycleLog.service(currentTime, stationsMoving());
+}
 
-  // Configure DNS server to redirect all domains to the ESP's IP
-  dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
+// Only what fits in the UART buffer, so the export never waits for the wire.
+// Console output goes first, so the two never interleave within a line.
+void exportInputTrace(unsigned long) {
+  if (inputTrace.isExporting() && !console.hasOutput()) {
+    inputTrace.exportTo(Serial, Serial.availableForWrite());
+  }
+}
+
+// One command per tick, output only as fast as the UART takes it
+void serviceConsole(unsigned long currentTime) {
+  console.poll(currentTime);
+  finishBench(currentTime);
+  if (!inputTrace.isExporting()) {
+    console.drain(Serial.availableForWrite());
+  }
+}
 
+// Inputs and remote commands change the states, power follows before the state
+// handlers run and the snapshot publishes the result
+void addLoopTasks() {
+  loopTasks.add("inputs", pollInputs, INPUT_PERIOD, TaskTable::PRIORITY_HIGH, 500);
+  loopTasks.add("remote", pollRemote, REMOTE_PERIOD, TaskTable::PRIORITY_NORMAL, 1000);
+  loopTasks.add("power", applyPowerPolicy, POWER_PERIOD, TaskTable::PRIORITY_NORMAL, 1000);
+  loopTasks.add("stations", serviceStations, 0, TaskTable::PRIORITY_HIGH, 1000);
+  loopTasks.add("cyclelog", serviceCycleLog, CYCLE_LOG_PERIOD, TaskTable::PRIORITY_LOW, 20000);
+  loopTasks.add("snapshot", publishSnapshot, SNAPSHOT_PERIOD, TaskTable::PRIORITY_NORMAL, 200);
+  loopTasks.add("trace", exportInputTrace, TRACE_EXPORT_PERIOD, TaskTable::PRIORITY_LOW, 500);
+  loopTasks.add("console", serviceConsole, CONSOLE_PERIOD, TaskTable::PRIORITY_LOW, 2000);
   #ifdef DEBUG
-  Serial.println("Access Point Started");
-  Serial.print("AP IP address: ");
-  Serial.println(WiFi.softAPIP());
+  loopTasks.add("debug", dumpDebug, DEBUG_PRINT_PERIOD, TaskTable::PRIORITY_LOW, 10000);
   #endif
+}
 
-  // Configure OTA
+#ifdef BENCHMARK
+// Runs the benchmark suite and halts, only built into the -bench environment.
+// The stepper driver stays disabled and the heater off, so a bare board is enough.
+void runBenchmarks() {
+  Serial.begin(SERIAL_BAUD);
+  Benchmark bench(Serial, "esp32");
+  runComponentBenchmarks(bench, buttonRotarySwitch, display, settings);
+
+  // The real step and direction pins with the driver left disabled, the relay
+  // replaced by the built-in LED
+  Station::Pins simulationPins = STATION_PINS[0];
+  simulationPins.relay = BUILTIN_LED_PIN;
+  simulationPins.heaterLed = Station::NO_PIN;
+  runStationBenchmarks(bench, settings, simulationPins);
+  runMotionTaskBenchmarks(bench, motionTask, display, settings, simulationPins);
+
+  Serial.println("Benchmarks done");
+  while (true) {
+    delay(1000);
+  }
+}
+#endif
+
+void setupOTA() {
   ArduinoOTA.setHostname("Skumfidus-OTA");
   ArduinoOTA.setPassword(ota_password);
 
   ArduinoOTA
     .onStart([]() {
+      // The transfer blocks the loop, so leave the machine safe for its duration
+      forceSafeOutputs();
+      failStations("OTA update", millis());
+      cycleLog.flush();  // Keep the cycles cut short by the update
+
       String type;
       if (ArduinoOTA.getCommand() == U_FLASH)
         type = "sketch";
@@ -608,6 +858,7 @@ void setup() {
       #endif
     })
     .onProgress([](unsigned int progress, unsigned int total) {
+      deadlineMonitor.checkIn();
       #ifdef DEBUG
       Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
       #endif
@@ -624,83 +875,204 @@ void setup() {
     });
 
   ArduinoOTA.begin();
+}
+
+// Brings up the access point, DNS and OTA in the background so the control loop starts immediately
+void networkSetupTask(void*) {
+  memoryMonitor.addTask("NetworkSetup", NULL, NETWORK_TASK_STACK_SIZE);
+
+  // Set up Access Point
+  WiFi.onEvent(updateStationCount, ARDUINO_EVENT_WIFI_AP_STACONNECTED);
+  WiFi.onEvent(updateStationCount, ARDUINO_EVENT_WIFI_AP_STADISCONNECTED);
+  WiFi.mode(WIFI_AP);
+  WiFi.softAP(ap_ssid, ap_password);
+  bootProfiler.mark("wifi");
+
+  // Configure DNS server to redirect all domains to the ESP's IP
+  captiveDns.begin(WiFi.softAPIP());
+  bootProfiler.mark("dns");
+
+  #ifdef DEBUG
+  Serial.println("Access Point Started");
+  Serial.print("AP IP address: ");
+  Serial.println(WiFi.softAPIP());
+  #endif
+
+  // Configure OTA
+  setupOTA();
+  bootProfiler.mark("ota");
+
+  remote.begin(ota_password);  // Signs the commands that move a carriage or change a setting
+
+  // Formats the partition on first use, which takes a few seconds
+  cycleLog.begin();
+  bootProfiler.mark("cyclelog");
 
   #ifdef DEBUG
   Serial.println("OTA Ready");
   #endif
+
+  networkReady = true;
+  memoryMonitor.recordTaskExit();
+  vTaskDelete(NULL);
 }
 
-void loop() {
-  ArduinoOTA.handle();
-  dnsServer.processNextRequest();
+void setup() {
+  bootProfiler.mark("start");
 
-  unsigned long currentTime = millis();
+  settings.loadSettingsFromPreferences();
+  bootProfiler.mark("settings");
+
+  // Initialize LED strip
+  initializeLEDStrip();
+  startLedTask();
+  bootProfiler.mark("leds");
+
+  // Debug output, the console and input trace exports
+  Serial.begin(SERIAL_BAUD);
+  console.begin(Serial);
 
-  // Debug
   #ifdef DEBUG
-  static unsigned long lastDebugPrint = 0;
-  dumpDebug();
+  // Print initial settings
+  displayCurrentSettings();
   #endif
 
-  // Update all ButtonHandler objects
-  buttonStart.update();
-  buttonLimitSwitch.update();
-  buttonRotarySwitch.update();
+  positionStore.begin();
 
-  // Read encoder value
-  encoderValue = encoder.getCount();
+  // Before the stations, which start their timers in begin()
+  bool timersReady = timerService.begin();
 
-  // Check if encoder value has changed
-  if (encoderValue != lastEncoderValue) {
-    // Handle encoder change
-    int32_t change = encoderValue - lastEncoderValue;
-    // You can use 'change' to update menu selection or modify values
-    // For example: menuIndex = (menuIndex + change) % MENU_ITEMS;
-    handleEncoderChange(encoderValue);
+  // Initialize pins, the stations set up their own
+  pinMode(ADDRESSABLE_LED_PIN, OUTPUT);
+
+  // Rotary Encoder
+  pinMode(ROTARY_CLK_PIN, INPUT_PULLUP);
+  pinMode(ROTARY_DT_PIN, INPUT_PULLUP);
+  pinMode(ROTARY_SW_PIN, INPUT_PULLUP);
+
+  // Initialize ButtonHandler objects
+  buttonRotarySwitch.begin();
+
+  // Initialize rotary encoder
+  rotary.begin(ROTARY_CLK_PIN, ROTARY_DT_PIN);
+
+  // The first station has the user interface, so it gets the rotary switch and the encoder
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    inputBus.addButton(stations[i].getStartButton(), InputEvent::SOURCE_START, i, Station::PARK_PRESS_DURATION);
   }
+  inputBus.addButton(buttonRotarySwitch, InputEvent::SOURCE_ROTARY_SWITCH, 0, Station::SETTINGS_PRESS_DURATION);
+  inputBus.setEncoder(rotary, 0);
 
-  // Check for homing switch trigger in any state except HOMING, STARTUP, and ERROR
-  if (currentSystemState != HOMING && currentSystemState != STARTUP && currentSystemState != ERROR && buttonLimitSwitch.getState()) {
-    changeState(ERROR, currentTime);
-    errorMessage = "Endstop trigger";
-    handleError();  // Immediately handle the error
-    return;  // Exit the loop to prevent further state processing
-  }
-
-  switch (currentSystemState) {
-    case STARTUP:
-      handleStartup(currentTime);
-      break;
-    case HOMING:
-      handleHoming(currentTime);
-      break;
-    case IDLE:
-      handleIdle();
-      break;
-    case RUNNING:
-      handleRunning(currentTime);
-      break;
-    case RETURNING_TO_START:
-      handleReturningToStart();
-      break;
-    case ERROR:
-      handleError();
-      break;
-    case SETTINGS_MENU:
-      if (!settings.isDone()) {
-        settings.update();
-      }
-      if (settings.isDone()) {
-        changeState(IDLE, currentTime);
-      }
-      break;
-    case PARKING:
-      handleParking();
-      break;
+  // Everything the input bus and the stations read, plus the endstops the motion task watches
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    inputTrace.addPin(STATION_PINS[i].start);
+    inputTrace.addPin(STATION_PINS[i].endstop);
+  }
+  inputTrace.addPin(ROTARY_SW_PIN);
+  inputTrace.setEncoder(rotary);
+  bootProfiler.mark("inputs");
+
+  // Initialize LCD and start MatrixDisplay update thread
+  display.begin();
+  layout.begin();  // Progress bar characters into CGRAM
+  display.startUpdateThread();
+  memoryMonitor.addTask("loop", NULL, getArduinoLoopTaskStackSize());  // setup() runs in the loop task
+  memoryMonitor.addTask("UpdateDisplay", display.getUpdateTaskHandle(), MatrixDisplay::UPDATE_TASK_STACK_SIZE);
+  memoryMonitor.addTask("Leds", ledTask, LED_TASK_STACK_SIZE);
+  bootProfiler.mark("display");
+
+  // Stations start with the driver disabled and the heater off. The first one
+  // gets the display, the rotary switch and the stored position.
+  stations[0].attachUserInterface(&display, &layout, &positionStore);
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    stations[i].begin(setStationLEDs, logCycle);
+    scheduler.add(stations[i]);
+  }
+  if (!timersReady) {
+    failStations("Timer failed", millis());  // No cook could end on time
+  }
+
+  #ifdef BENCHMARK
+  runBenchmarks();  // Does not return
+  #endif
+
+  // Stepping moves out of the loop; without the task the scheduler keeps polling the steppers itself
+  if (motionTask.begin(scheduler)) {
+    scheduler.setMotionPolling(false);
+    memoryMonitor.addTask("Motion", motionTask.getTaskHandle(), MotionTask::STACK_SIZE);
+  }
+
+  // Network bring-up is slow, run it on core 0 next to the display task
+  xTaskCreatePinnedToCore(networkSetupTask, "NetworkSetup", NETWORK_TASK_STACK_SIZE, NULL, 1, NULL, 0);
+
+  // Loop budgets in microseconds. Motion states poll the stepper, so a slow pass stretches step intervals.
+  deadlineMonitor.setBudget(STARTUP, 20000);
+  deadlineMonitor.setBudget(HOMING, 1000);
+  deadlineMonitor.setBudget(IDLE, 20000);
+  deadlineMonitor.setBudget(RUNNING, 1000);
+  deadlineMonitor.setBudget(RETURNING_TO_START, 1000);
+  deadlineMonitor.setBudget(ERROR, 50000);
+  deadlineMonitor.setBudget(SETTINGS_MENU, 50000);
+  deadlineMonitor.setBudget(PARKING, 1000);
+  deadlineMonitor.begin(forceSafeOutputs, LOOP_GUARD_TIMEOUT, LOOP_WATCHDOG_TIMEOUT);
+
+  // Power profiles, every other state runs at full power
+  powerPolicy.setProfile(IDLE, PowerPolicy::PROFILE_SLEEP);
+  powerPolicy.setProfile(SETTINGS_MENU, PowerPolicy::PROFILE_REDUCED);
+  powerPolicy.setProfile(ERROR, PowerPolicy::PROFILE_REDUCED);
+  powerPolicy.setTimeouts(POWER_REDUCE_DELAY, LIGHT_SLEEP_DELAY, STEPPER_IDLE_TIMEOUT);
+
+  addLoopTasks();
+  addConsoleCommands();
+
+  bootProfiler.mark("setup");
+}
+
+void loop() {
+  SystemState state = activeState();
+  deadlineMonitor.loopCheckIn(state);
+
+  // The guard forced the outputs off while the loop was stuck, do not carry on as if nothing happened
+  if (deadlineMonitor.hasTripped()) {
+    deadlineMonitor.clearTrip();
+    if (failStations("Loop stalled", millis())) {
+      return;
+    }
+  }
+
+  // Uploads are only accepted in OTA mode, so one never lands in the middle of a cook
+  if (otaMode) {
+    publishSnapshot(millis());
+    handleOtaMode();
+    deadlineMonitor.discardIteration();
+    return;
   }
 
-  // Reset changed states after handling
-  buttonStart.reset();
-  buttonLimitSwitch.reset();
-  buttonRotarySwitch.reset();
+  // Each subsystem at its own rate, the stations on every pass. The state's loop budget
+  // decides when lower-priority ticks wait for the next pass.
+  unsigned long currentTime = millis();
+  loopTasks.run(currentTime, deadlineMonitor.getStats(state).budget);
+
+  // Every station parked, stop all processing until the power is turned off
+  bool allParked = true;
+  for (uint8_t i = 0; i < STATION_COUNT; i++) {
+    allParked = allParked && stations[i].isParked();
+  }
+  if (allParked) {
+    cycleLog.flush();
+    delay(100);  // Let the display task draw the message before sleeping
+    setCpuFrequencyMhz(PowerPolicy::REDUCED_CPU_MHZ);
+    while (true) {
+      // Infinite loop to stop all processing
+      deadlineMonitor.checkIn();
+      lightSleep(1000);
+    }
+  }
+
+  // Idle with nobody connected, sleep until an input changes or the next awake window.
+  // After an input woke it, stay awake until the power task has seen the input.
+  if (!wokeByInput && powerPolicy.allowsLightSleep()) {
+    wokeByInput = lightSleep(LIGHT_SLEEP_PERIOD);
+    powerPolicy.recordWake(millis());
+  }
 }